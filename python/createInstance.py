@@ -3,7 +3,7 @@ import numpy as np
 import json
 import random
 
-def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5, pickersPerWarehouse: int=3, meanComissionTime: int=120, meanServiceTimeAtClient: int=60):
+def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5, pickersPerWarehouse: int=3, meanComissionTime: int=120, meanServiceTimeAtClient: int=60, slotDurationFiles: list=None, timeSlotLength: int=900, arrivalRates: list=None, clientWeightsFromStops: bool=False):
     """Create a .txt file of a problem instance
     Args:
         fileName (str): File in which we save the instance parameters
@@ -13,6 +13,10 @@ def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5,
         interArrivalTime (int): arrival rate (exponentially distributed) of orders (in seconds)
         meanComissionTime (int): Time a picker needs on average to comission an order (expoentially distributed) (in seconds)
         meanServiceTimeAtClient (int): Mean time a courier needs at the clients door to deliver the order (expoentially distributed) (in seconds)
+        slotDurationFiles (list): Optional list of duration files (same layout as allDurations15.csv), one per time slot of the day. If given, the travel times change over the day
+        timeSlotLength (int): Length of a time slot (in seconds), only used with slotDurationFiles
+        arrivalRates (list): Optional list of (start time in seconds, mean inter arrival time in seconds) pairs, starting at 0. If given, the demand follows this profile instead of the inter arrival time of the command line
+        clientWeightsFromStops (bool): If True, each client is weighted by the number of stops of data/stopData15Minutes.csv at (about) the same location, so busy areas order more often
     Returns:
         None 
     """
@@ -39,6 +43,21 @@ def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5,
     clients = np.delete(clients, notInLimit, axis=0)
     matrix = np.delete(matrix, notInLimit, axis=0)
 
+    # Travel times per time slot, for the same clients
+    slotMatrices = []
+    if slotDurationFiles:
+        for slotFile in slotDurationFiles:
+            slotMatrix = pd.read_csv(slotFile, header=0).to_numpy()[rndIdxs,3:].astype(int)
+            slotMatrices.append(np.delete(slotMatrix, notInLimit, axis=0))
+
+    # Number of stops in the same cell of about 100 m, the clients are a subset of these stops
+    clientWeights = []
+    if clientWeightsFromStops:
+        stops = pd.read_csv("data/stopData15Minutes.csv", header=0)
+        cells = stops[["Latitude", "Longitude"]].round(3)
+        stopsPerCell = cells.groupby(["Latitude", "Longitude"]).size()
+        clientWeights = [stopsPerCell.get((round(lat, 3), round(lon, 3)), 1) for (x, lon, lat) in clients]
+
     with open("instances/"+fileName+".txt", 'w') as f:
         f.write("\n".join([
             "{} : {}".format(k, v)
@@ -50,6 +69,11 @@ def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5,
                 ("MEAN_SERVICE_AT_CLIENT_TIME", meanServiceTimeAtClient)]
         ]))
         f.write("\n")
+        if slotMatrices:
+            f.write("TIME_SLOT_LENGTH : {}\n".format(timeSlotLength))
+            f.write("NUMBER_TIME_SLOTS : {}\n".format(len(slotMatrices)))
+        if arrivalRates:
+            f.write("NUMBER_ARRIVAL_RATES : {}\n".format(len(arrivalRates)))
         
         f.write("WAREHOUSE_SECTION\n")
         f.write("\n".join([
@@ -66,10 +90,32 @@ def create_instance(fileName: str, limit: int=900, couriersPerWarehouse: int=5,
         ]))
         f.write("\n")
 
+        if arrivalRates:
+            f.write("ARRIVAL_RATE_SECTION\n")
+            for startTime, meanInterArrivalTime in arrivalRates:
+                f.write("{}\t{}\n".format(startTime, meanInterArrivalTime))
+
+        if clientWeights:
+            f.write("CLIENT_WEIGHT_SECTION\n")
+            f.write("\n".join([
+                "{}\t{}".format(i, w)
+                for i, w in enumerate(clientWeights)
+            ]))
+            f.write("\n")
+
         f.write("EDGE_WEIGHT_SECTION\n")
         for row in matrix:
             f.write("\t".join(map(str, row)))
             f.write("\n")
+
+        if slotMatrices:
+            # Identical slots are written anyway, they are only stored once when the instance is read
+            f.write("TIME_DEPENDENT_EDGE_WEIGHT_SECTION\n")
+            for slot, slotMatrix in enumerate(slotMatrices):
+                f.write("SLOT {}\n".format(slot))
+                for row in slotMatrix:
+                    f.write("\t".join(map(str, row)))
+                    f.write("\n")
         
         
         f.write("EOF\n")
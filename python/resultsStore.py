@@ -0,0 +1,61 @@
+import struct
+import warnings
+import numpy as np
+import pandas as pd
+
+
+def read_results_store(fileName: str):
+    """Read a results store written with --resultsStore into one DataFrame
+    Args:
+        fileName (str): File of the results store
+    Returns:
+        DataFrame with one row per epoch of each run: the metric columns of the run and its metadata (instance, penalty, method, lambdas, options, ...) as string columns.
+        Runs without a metric have NaN in its column. A truncated last block (e.g., of a killed run) is skipped with a warning,
+        a block with an impossible size raises a ValueError
+    """
+    with open(fileName, "rb") as file:
+        buffer = file.read()
+    frames = []
+    position = 0
+    while position + 20 <= len(buffer):
+        magic, blockSize, nbRows, nbColumns, nbMetadata = struct.unpack_from("<4sIIII", buffer, position)
+        if magic != b"ORS1":
+            raise ValueError("Corrupted results store at byte " + str(position))
+        # A block has at least its header, padded to 8 bytes, and its values
+        if blockSize < 24 or blockSize % 8 != 0 or blockSize < 24 + 8 * nbRows * nbColumns:
+            raise ValueError("Corrupted results store: block of " + str(blockSize) + " bytes at byte " + str(position))
+        if position + blockSize > len(buffer):
+            warnings.warn("Skipped the truncated last block of the results store at byte " + str(position))
+            break
+        offset = position + 20
+
+        def read_string():
+            nonlocal offset
+            length, = struct.unpack_from("<I", buffer, offset)
+            text = buffer[offset + 4:offset + 4 + length].decode()
+            offset += 4 + length
+            return text
+
+        metadata = {}
+        for _i in range(nbMetadata):
+            key = read_string()
+            metadata[key] = read_string()
+        columns = [read_string() for _i in range(nbColumns)]
+        offset = position + (offset - position + 7) // 8 * 8
+        if offset + 8 * nbRows * nbColumns != position + blockSize:
+            raise ValueError("Corrupted results store: inconsistent block at byte " + str(position))
+        values = np.frombuffer(buffer, dtype="<f8", count=nbRows * nbColumns, offset=offset).reshape(nbColumns, nbRows)
+        df = pd.DataFrame({column: values[c] for c, column in enumerate(columns)})
+        for key, value in metadata.items():
+            df[key] = value
+        frames.append(df)
+        position += blockSize
+    if not frames:
+        return pd.DataFrame()
+    return pd.concat(frames, ignore_index=True)
+
+
+if __name__ == "__main__":
+    import sys
+    df = read_results_store(sys.argv[1] if len(sys.argv) > 1 else "data/experimentData/results.ors")
+    print(df.groupby(["kind", "method", "penalty", "interArrivalTime"], dropna=False)["costs"].agg(["count", "mean", "std"]))
@@ -0,0 +1,140 @@
+#ifndef ARRIVALPROCESS_H
+#define ARRIVALPROCESS_H
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Sampling.h"
+#include "xorshift128.h"
+
+// Implementation of Walker's alias method (in the variant of Vose) to draw an index with probability proportional to a weight
+// After a linear setup, each draw costs one random number, one multiplication and two loads, independently of the number of weights
+class AliasTable
+{
+    std::vector<double> probability_;   // Probability to keep the drawn column
+    std::vector<int> alias_;            // Index that is taken otherwise
+
+public:
+    // Empty constructor: without weights
+    AliasTable()
+    {}
+
+    // Constructor: table for the given non-negative weights, at least one of them positive
+    explicit AliasTable(const std::vector<double>& weights) : probability_(weights.size()), alias_(weights.size())
+    {
+        const int n = weights.size();
+        double total = 0.0;
+        for (double weight : weights)
+        {
+            if (weight < 0.0) throw std::invalid_argument("Weights of an alias table must not be negative");
+            total += weight;
+        }
+        if (total <= 0.0) throw std::invalid_argument("Weights of an alias table must not all be zero");
+
+        // Columns are filled up to the average by the remainder of columns above it
+        std::vector<double> scaled(n);
+        std::vector<int> small, large;
+        for (int i = 0; i < n; i++)
+        {
+            scaled[i] = weights[i] * n / total;
+            if (scaled[i] < 1.0) small.push_back(i);
+            else large.push_back(i);
+        }
+        while (!small.empty() && !large.empty())
+        {
+            int s = small.back(); small.pop_back();
+            int l = large.back();
+            probability_[s] = scaled[s];
+            alias_[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // The remaining columns are full (up to rounding errors)
+        for (int i : large) { probability_[i] = 1.0; alias_[i] = i; }
+        for (int i : small) { probability_[i] = 1.0; alias_[i] = i; }
+    }
+
+    // Draw an index with one draw of the random number generator
+    int sample(XorShift128& rng) const
+    {
+        double u = drawUniform(rng) * probability_.size();
+        int column = (int)u;
+        return (u - column) < probability_[column] ? column : alias_[column];
+    }
+
+    // Number of weights
+    int size() const
+    {
+        return (int)probability_.size();
+    }
+};
+
+// Implementation of a non-homogeneous Poisson arrival process whose rate is piecewise constant over time (e.g., per hour of the day)
+// Arrival times are drawn by inversion: a unit-rate exponential number is mapped through the inverse of the cumulative arrival rate.
+// For a piecewise constant rate this is exact and needs one random number per arrival, without rejected candidates as in thinning
+class ArrivalProfile
+{
+    std::vector<double> startTimes_;            // Start time of each segment (in seconds), increasing, the first one is 0
+    std::vector<double> meanInterArrivalTimes_; // Mean inter arrival time of each segment (in seconds), 0 if no orders arrive in the segment
+
+public:
+    // Add a segment that starts at startTime. The last segment lasts forever
+    void addSegment(double startTime, double meanInterArrivalTime)
+    {
+        if (startTimes_.empty() ? startTime != 0.0 : startTime <= startTimes_.back()) throw std::invalid_argument("Arrival rate segments must start at 0 and be increasing");
+        if (meanInterArrivalTime < 0.0) throw std::invalid_argument("Mean inter arrival times must not be negative");
+        startTimes_.push_back(startTime);
+        meanInterArrivalTimes_.push_back(meanInterArrivalTime);
+    }
+
+    // Number of segments
+    int nbSegments() const
+    {
+        return (int)startTimes_.size();
+    }
+
+    // Start time and mean inter arrival time of a segment
+    double startTime(int segment) const { return startTimes_[segment]; }
+    double meanInterArrivalTime(int segment) const { return meanInterArrivalTimes_[segment]; }
+
+    // Draw the times of the next nbArrivals arrivals after time start and append them to times (as a batch, the segment is only searched once).
+    // If no orders arrive in the last segment, the arrivals after it have infinite times
+    void drawArrivalTimes(double start, size_t nbArrivals, XorShift128& rng, std::vector<double>& times) const
+    {
+        int segment = 0;
+        while (segment + 1 < (int)startTimes_.size() && startTimes_[segment + 1] <= start) segment++;
+        double time = start;
+        for (size_t a = 0; a < nbArrivals; a++)
+        {
+            // Unit-rate exponential time that is consumed segment by segment
+            double remaining = -std::log(1.0 - drawUniform(rng));
+            for (;;)
+            {
+                double end = segment + 1 < (int)startTimes_.size() ? startTimes_[segment + 1] : std::numeric_limits<double>::infinity();
+                double rate = meanInterArrivalTimes_[segment] > 0.0 ? 1.0 / meanInterArrivalTimes_[segment] : 0.0;
+                if (rate > 0.0 && remaining <= (end - time) * rate)
+                {
+                    time += remaining / rate;
+                    break;
+                }
+                if (end == std::numeric_limits<double>::infinity())
+                {
+                    time = end;
+                    break;
+                }
+                remaining -= (end - time) * rate;
+                time = end;
+                segment++;
+            }
+            times.push_back(time);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "AuctionSolver.h"
+
+
+AuctionSolver::AuctionSolver() : nbRows(0), nbColumns(0), lastRow(-1), nbBids(0)
+{
+}
+
+void AuctionSolver::reset(int nbRows, int nbColumns)
+{
+    this->nbRows = nbRows;
+    this->nbColumns = nbColumns;
+    rowStart = std::vector<int>(nbRows + 1, 0);
+    lastRow = -1;
+    edgeColumn.clear();
+    edgeBenefit.clear();
+}
+
+void AuctionSolver::addEdge(int row, int column, double benefit)
+{
+    if (row < lastRow || row >= nbRows || column < 0 || column >= nbColumns) throw std::out_of_range("Auction edge out of range or out of order");
+    // Rows up to this one (including rows without edges) start here
+    while (lastRow < row){
+        lastRow++;
+        rowStart[lastRow] = edgeColumn.size();
+    }
+    edgeColumn.push_back(column);
+    edgeBenefit.push_back(benefit);
+}
+
+bool AuctionSolver::solve(std::vector<int>& assignment, double epsilon, long maxBids, double timeBudget)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    assignment = std::vector<int>(nbRows, -1);
+    prices = std::vector<double>(nbColumns, 0.0);
+    owner = std::vector<int>(nbColumns, -1);
+    nbBids = 0;
+    // Close the remaining rows
+    while (lastRow < nbRows){
+        lastRow++;
+        rowStart[lastRow] = edgeColumn.size();
+    }
+
+    std::vector<int> unassignedRows;
+    for (int row = nbRows - 1; row >= 0; row--){
+        if (rowStart[row + 1] > rowStart[row]) unassignedRows.push_back(row);
+    }
+
+    while (!unassignedRows.empty()){
+        // Check the budget every 64 bids, reading the clock is more expensive than a bid
+        if (nbBids >= maxBids || ((nbBids & 63) == 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() > timeBudget)){
+            return false;
+        }
+        int row = unassignedRows.back();
+        unassignedRows.pop_back();
+
+        // Find the best and second best value (benefit - price) over the candidate columns of the row
+        int bestColumn = -1;
+        double bestValue = -std::numeric_limits<double>::infinity();
+        double secondBestValue = -std::numeric_limits<double>::infinity();
+        for (int e = rowStart[row]; e < rowStart[row + 1]; e++){
+            double value = edgeBenefit[e] - prices[edgeColumn[e]];
+            if (value > bestValue){
+                secondBestValue = bestValue;
+                bestValue = value;
+                bestColumn = edgeColumn[e];
+            }else if (value > secondBestValue){
+                secondBestValue = value;
+            }
+        }
+        // A row with a single candidate raises the price just by epsilon, nobody else competes for it over this row
+        double bidIncrement = (secondBestValue == -std::numeric_limits<double>::infinity()) ? epsilon : bestValue - secondBestValue + epsilon;
+        prices[bestColumn] += bidIncrement;
+        nbBids++;
+
+        // The previous owner of the column is outbid and has to bid again
+        if (owner[bestColumn] != -1){
+            assignment[owner[bestColumn]] = -1;
+            unassignedRows.push_back(owner[bestColumn]);
+        }
+        owner[bestColumn] = row;
+        assignment[row] = bestColumn;
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef AUCTIONSOLVER_H
+#define AUCTIONSOLVER_H
+
+#include <vector>
+
+// Implementation of Bertsekas' forward auction algorithm for sparse assignment problems
+// Each row (e.g., an order) has to be assigned to one of its candidate columns (e.g., a courier of a warehouse), each column takes at most one row,
+// and the sum of the benefits of the chosen edges is maximized. Rows bid for their best column, raising its price by the difference to their
+// second best column plus epsilon. With integer benefits and epsilon < 1/nbRows the final assignment is optimal.
+// For more information, see: D. P. Bertsekas, "The auction algorithm: A distributed relaxation method for the assignment problem", 1988
+class AuctionSolver
+{
+public:
+	// Constructor
+	AuctionSolver();
+
+	// Start a new problem. Edges have to be added row by row, i.e., all edges of row 0, then all edges of row 1, etc.
+	void reset(int nbRows, int nbColumns);
+
+	// Add an edge between row and column with the given benefit
+	void addEdge(int row, int column, double benefit);
+
+	// Solve the problem. assignment[row] is the column of the row afterwards (-1 if the row has no edge or the budget was exceeded).
+	// Returns false if the solver stopped because it exceeded maxBids or timeBudget (in seconds); rows that are unassigned then need a fallback
+	bool solve(std::vector<int>& assignment, double epsilon, long maxBids, double timeBudget);
+
+	// Number of bids of the last solve
+	long getNbBids() const { return nbBids; }
+
+private:
+	int nbRows;							// Number of rows
+	int nbColumns;						// Number of columns
+	std::vector<int> rowStart;			// Index of the first edge of each row (compressed sparse row layout), rowStart[nbRows] is the number of edges
+	int lastRow;						// Last row whose start has been set
+	std::vector<int> edgeColumn;		// Column of each edge
+	std::vector<double> edgeBenefit;	// Benefit of each edge
+	std::vector<double> prices;			// Price of each column
+	std::vector<int> owner;				// Row that currently holds each column (-1 if none)
+	long nbBids;						// Number of bids of the last solve
+};
+
+#endif
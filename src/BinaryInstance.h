@@ -0,0 +1,16 @@
+#ifndef BINARYINSTANCE_H
+#define BINARYINSTANCE_H
+
+#include <cstdint>
+
+// Binary format of an instance, written by the instance builder and read by Data as an alternative to the text format.
+// All values are stored in native byte order, one after another:
+//   char[4] magic "OAIN", uint32 version, uint32 length of the name, char[] name
+//   int32 number of clients, int32 number of warehouses, double mean comission time, double mean service time at the client
+//   per warehouse: int32 ID, double longitude, double latitude, int32 initial number of couriers, int32 initial number of pickers
+//   per client: int32 ID, double longitude, double latitude
+//   int32 travel times from each client (rows) to each warehouse (columns)
+static const char binaryInstanceMagic[4] = {'O', 'A', 'I', 'N'};
+static const uint32_t binaryInstanceVersion = 1;
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// Implementation of a bounded, lock-free multi-producer multi-consumer queue (Dmitry Vyukov's array-based queue)
+// Each cell carries a sequence number that tells producers and consumers whether the cell is free or filled for their turn,
+// so an enqueue or dequeue only needs a single compare-and-swap on the respective position counter.
+// push and pop wait on a condition variable while the queue is full or empty; the mutex is only taken to wait and to wake the waiting threads up.
+// For more information, see: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+template <typename T>
+class BoundedQueue
+{
+    struct Cell
+    {
+        std::atomic<size_t> sequence;           // Position in the queue the cell is ready for
+        T value;                                // The stored element
+    };
+
+    std::unique_ptr<Cell[]> buffer_;            // Ring buffer of cells
+    size_t mask_;                               // Capacity - 1, the capacity is a power of two
+    char padding0_[64];                         // Keep the two position counters on separate cache lines
+    std::atomic<size_t> enqueuePos_;            // Next position to write to
+    char padding1_[64];
+    std::atomic<size_t> dequeuePos_;            // Next position to read from
+    char padding2_[64];
+    std::mutex mutex_;                          // Mutex of the waiting threads
+    std::condition_variable changed_;           // Wakes the waiting threads up after a push, a pop or close
+    bool closed_;                               // Whether push and pop return instead of waiting
+
+public:
+    // Constructor: capacity must be a power of two (at least 2)
+    BoundedQueue(const size_t capacity) : buffer_(new Cell[capacity]), mask_(capacity - 1), enqueuePos_(0), dequeuePos_(0), closed_(false)
+    {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) throw std::invalid_argument("BoundedQueue capacity must be a power of two");
+        for (size_t i = 0; i < capacity; i++)
+        {
+            buffer_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Move value into the queue. Returns false (and leaves value untouched) if the queue is full
+    bool tryPush(T& value)
+    {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+            if (difference == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) return false;
+            else pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Move the oldest element of the queue into value. Returns false if the queue is empty
+    bool tryPop(T& value)
+    {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &buffer_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)(pos + 1);
+            if (difference == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) return false;
+            else pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Same as tryPush, but waits while the queue is full. Returns false (and leaves value untouched) if the queue is closed
+    bool push(T& value)
+    {
+        if (!tryPush(value))
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&]{ return closed_ || tryPush(value); });
+            if (closed_) return false;
+        }
+        notify();
+        return true;
+    }
+
+    // Same as tryPop, but waits while the queue is empty. Returns false if the queue is closed
+    bool pop(T& value)
+    {
+        if (!tryPop(value))
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&]{ return closed_ || tryPop(value); });
+            if (closed_) return false;
+        }
+        notify();
+        return true;
+    }
+
+    // Wake up all waiting threads, from now on push and pop return false instead of waiting
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        changed_.notify_all();
+    }
+
+private:
+    // A thread that is about to wait checks the queue while it holds the mutex, so taking it here before the notification is enough not to miss it
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        changed_.notify_all();
+    }
+};
+
+#endif
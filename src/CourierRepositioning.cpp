@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "CourierRepositioning.h"
+#include "Sampling.h"
+
+
+CourierRepositioning::CourierRepositioning(const Data& data) : outputBias(0.0f)
+{
+    policy = data.getOption("repositioning", "home");
+    if (policy != "home" && policy != "backlog" && policy != "net") throw std::invalid_argument("Unknown repositioning policy: " + policy);
+    useNet = policy == "net";
+    nbCandidates = 1 + std::max(0, std::min((int)data.getOption("repositioningCandidates", 3.0), data.nbWarehouses - 1));
+    weight = data.getOption("repositioningWeight", 300.0);
+    timeBudget = data.getOption("repositioningBudget", 0.00005);
+    netFileName = data.getOption("repositioningNet", "src/repositioningNet_REINFORCE.pt");
+    scores.reserve(nbCandidates);
+    resetStatistics();
+}
+
+void CourierRepositioning::setNet(repositioningNetwork& net)
+{
+    torch::NoGradGuard noGrad;
+    torch::Tensor w1 = net.fc1->weight.detach().contiguous();
+    torch::Tensor b1 = net.fc1->bias.detach().contiguous();
+    torch::Tensor w2 = net.fc2->weight.detach().contiguous();
+    torch::Tensor b2 = net.fc2->bias.detach().contiguous();
+    hiddenWeights.assign(w1.data_ptr<float>(), w1.data_ptr<float>() + nbHidden * nbFeatures);
+    hiddenBiases.assign(b1.data_ptr<float>(), b1.data_ptr<float>() + nbHidden);
+    outputWeights.assign(w2.data_ptr<float>(), w2.data_ptr<float>() + nbHidden);
+    outputBias = b2.data_ptr<float>()[0];
+}
+
+void CourierRepositioning::loadNet(const std::string& fileName)
+{
+    auto net = std::make_shared<repositioningNetwork>(nbFeatures, nbHidden);
+    torch::load(net, fileName);
+    setNet(*net);
+}
+
+void CourierRepositioning::getFeatures(const RepositioningCandidate& candidate, float* features)
+{
+    // Travel times are in units of 10 minutes, so all features are of the order of a few units
+    features[0] = candidate.travelTime / 600.0f;
+    features[1] = candidate.backlog;
+    features[2] = candidate.couriers;
+    features[3] = candidate.initialCouriers;
+    features[4] = candidate.isHome ? 1.0f : 0.0f;
+}
+
+float CourierRepositioning::score(const RepositioningCandidate& candidate) const
+{
+    if (!useNet)
+    {
+        int shortage = candidate.backlog + candidate.initialCouriers - candidate.couriers;
+        return (float)(weight * shortage - candidate.travelTime);
+    }
+    float features[nbFeatures];
+    getFeatures(candidate, features);
+    float value = outputBias;
+    for (int h = 0; h < nbHidden; h++)
+    {
+        float hidden = hiddenBiases[h];
+        for (int f = 0; f < nbFeatures; f++)
+        {
+            hidden += hiddenWeights[h * nbFeatures + f] * features[f];
+        }
+        value += outputWeights[h] * std::max(hidden, 0.0f);
+    }
+    return value;
+}
+
+int CourierRepositioning::choose(const std::vector<RepositioningCandidate>& candidates, bool sample, double u)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    scores.clear();
+    int best = 0;
+    for (size_t c = 0; c < candidates.size(); c++)
+    {
+        scores.push_back(score(candidates[c]));
+        if (scores[c] > scores[best]) best = c;
+        if (!sample && timeBudget > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() >= timeBudget) break;
+    }
+    if (sample && useNet)
+    {
+        // Softmax of the scores, shifted by the highest one so the exponentials cannot overflow
+        const float maxScore = scores[best];
+        for (float& s : scores)
+        {
+            s = std::exp(s - maxScore);
+        }
+        best = sampleFromRow(scores.data(), scores.size(), u);
+    }
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    nbDecisions++;
+    if (best != 0) nbMoves++;
+    if (timeBudget > 0 && time > timeBudget) nbOverBudget++;
+    totalTime += time;
+    maxTime = std::max(maxTime, time);
+    return best;
+}
+
+void CourierRepositioning::resetStatistics()
+{
+    nbDecisions = 0;
+    nbMoves = 0;
+    nbOverBudget = 0;
+    totalTime = 0.0;
+    maxTime = 0.0;
+}
+
+std::string CourierRepositioning::describe() const
+{
+    std::ostringstream text;
+    text << "Repositioning (" << policy << ") decisions: " << nbDecisions << " Moved to another warehouse: " << nbMoves
+         << " Mean decision time: " << (nbDecisions > 0 ? 1e6 * totalTime / nbDecisions : 0.0) << " us. Max decision time: " << 1e6 * maxTime
+         << " us. Over budget: " << nbOverBudget;
+    return text.str();
+}
@@ -0,0 +1,104 @@
+#ifndef COURIERREPOSITIONING_H
+#define COURIERREPOSITIONING_H
+
+#include <string>
+#include <vector>
+
+#include <torch/torch.h>
+#include "Data.h"
+
+// Candidate warehouse of a repositioning decision, with the live state of the warehouse
+struct RepositioningCandidate
+{
+	int warehouse;				// Index of the warehouse
+	int travelTime;				// Travel time from the client to the warehouse (in seconds)
+	int backlog;				// Orders waiting for a courier at the warehouse
+	int couriers;				// Couriers assigned to the warehouse, including the ones driving back to it
+	int initialCouriers;		// Couriers the warehouse starts with
+	bool isHome;				// True for the warehouse the courier came from
+};
+
+// Network that scores a candidate warehouse from its features. The same weights score every candidate of a decision,
+// and the scores of the candidates are turned into probabilities with a softmax
+struct repositioningNetwork : torch::nn::Module {
+	repositioningNetwork(int64_t nbFeatures, int64_t nbHidden) {
+		fc1 = register_module("fc1", torch::nn::Linear(nbFeatures, nbHidden));
+		fc2 = register_module("fc2", torch::nn::Linear(nbHidden, 1));
+	}
+
+	// x has the shape (decisions, candidates, features), the result (decisions, candidates)
+	torch::Tensor forward(torch::Tensor x) {
+		x = torch::relu(fc1->forward(x));
+		x = fc2->forward(x).squeeze(2);
+		return torch::softmax(x, /*dim=*/1);
+	}
+
+	torch::nn::Linear fc1{nullptr}, fc2{nullptr};
+};
+
+// Class that decides to which warehouse a courier drives after serving a client (--repositioning):
+// - home: back to the warehouse it came from
+// - backlog: the candidate with the lowest travel time minus --repositioningWeight seconds per order the warehouse is short of,
+//   i.e., its backlog plus its initial couriers minus the couriers assigned to it
+// - net: the candidate with the highest score of a repositioningNetwork trained with REINFORCE
+// The candidates are the home warehouse and the --repositioningCandidates other warehouses nearest to the client. The net is evaluated on a copy
+// of its weights in plain arrays, without libtorch. Candidates are scored home first, then by travel time, and once --repositioningBudget seconds
+// have passed no further candidate is scored, so a decision overruns the budget by at most one candidate
+class CourierRepositioning
+{
+public:
+	static const int nbFeatures = 5;		// Features of a candidate, see getFeatures
+	static const int nbHidden = 16;			// Hidden units of the net
+
+	// Constructor: reads the options of the policy
+	CourierRepositioning(const Data& data);
+
+	const std::string& getPolicy() const { return policy; }
+	// True if couriers may be sent to another warehouse than the one they came from
+	bool isActive() const { return policy != "home"; }
+	// Number of candidates of each decision (the home warehouse and the nearest others)
+	int getNbCandidates() const { return nbCandidates; }
+	// Number of other warehouses that are candidates
+	int getNbNearest() const { return nbCandidates - 1; }
+	// File of the net, and true if the policy needs a net that has not been set yet
+	const std::string& getNetFileName() const { return netFileName; }
+	bool needsNet() const { return policy == "net" && hiddenWeights.empty(); }
+
+	// Functions that copy the weights of a net (e.g., after each training step) or load them from a file
+	void setNet(repositioningNetwork& net);
+	void loadNet(const std::string& fileName);
+
+	// Function that writes the nbFeatures features of a candidate
+	static void getFeatures(const RepositioningCandidate& candidate, float* features);
+
+	// Function that returns the index of the chosen candidate, the home warehouse must be the first one. With sample (in training), the net
+	// draws the candidate from its probabilities with the uniform number u and the budget does not apply
+	int choose(const std::vector<RepositioningCandidate>& candidates, bool sample, double u);
+
+	// Functions that reset the decision counters and describe them in one line
+	void resetStatistics();
+	std::string describe() const;
+
+private:
+	std::string policy;							// "home", "backlog" or "net"
+	bool useNet;								// True if the candidates are scored by the net
+	int nbCandidates;							// Number of candidates of a decision
+	double weight;								// Seconds of travel time per order a warehouse is short of (backlog policy)
+	double timeBudget;							// Time budget of a decision (in seconds), unlimited if not positive
+	std::string netFileName;					// File the net is loaded from
+	std::vector<float> hiddenWeights;			// Weights of the net: nbHidden x nbFeatures, then the biases of the hidden units,
+	std::vector<float> hiddenBiases;			// the weights of the output and its bias
+	std::vector<float> outputWeights;
+	float outputBias;
+	std::vector<float> scores;					// Scores of the candidates of the current decision
+	long nbDecisions;							// Decisions, decisions that moved the courier to another warehouse and decisions over budget
+	long nbMoves;
+	long nbOverBudget;
+	double totalTime;							// Total and maximum time of a decision (in seconds)
+	double maxTime;
+
+	// Function that returns the score of a candidate, higher is better
+	float score(const RepositioningCandidate& candidate) const;
+};
+
+#endif
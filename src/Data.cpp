@@ -6,30 +6,65 @@
 #include <vector>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 
+#include "BinaryInstance.h"
 #include "Data.h"
 #include "Matrix.h"
+#include "TimeDependentMatrix.h"
 #include "xorshift128.h"
 
 
 
-Data::Data(char * argv[])
+Data::Data(char * argv[], const std::map<std::string, std::string>& options) : options(options)
+{
+	for (int i = 0; argv[i] != nullptr; i++)
+	{
+		arguments.push_back(argv[i]);
+		commandLine += (i > 0 ? " " : "") + std::string(argv[i]);
+	}
+	std::ifstream inputFile(argv[1], std::ios::binary);
+	if (!inputFile) throw std::runtime_error("Could not find file instance");
+	readInstance(inputFile, std::stoi(argv[3]), std::stoi(argv[4]));
+}
+
+Data::Data(std::istream& instance, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options) : options(options)
+{
+	if (!instance) throw std::runtime_error("Could not read instance");
+	readInstance(instance, penaltyForNotServing, interArrivalTime);
+}
+
+void Data::readInstance(std::istream& inputFile, int penaltyForNotServing, double interArrivalTime)
 {
 	rng = XorShift128(0);
 	nbClients = 0;
 	nbWarehouses = 0;
 	nbCouriers = 0;
 	nbPickers = 0;
-	penaltyForNotServing = std::stoi(argv[3]);
-	interArrivalTime = std::stoi(argv[4]);
+	this->penaltyForNotServing = penaltyForNotServing;
+	this->interArrivalTime = interArrivalTime;
 	meanCommissionTime = 180;
 	meanServiceTimeAtClient = 60;
+	timeSlotLength = 24*3600;
+	nbTimeSlots = 1;
+	nbArrivalRates = 0;
 	paramClients = std::vector<Client>(40000); // 40000 is an upper limit, can be increase ofc
 	paramWarehouses = std::vector<Warehouse>(30); // 30 is an upper limit, can be increased ofc
 	std::string content, content2, content3;
-	std::ifstream inputFile(argv[1]);
-	if (!inputFile) throw std::runtime_error("Could not find file instance");
-	if (inputFile.is_open())
+	// Instances written by the instance builder with --binary start with a magic number, otherwise the text format is read
+	char magic[4] = {};
+	inputFile.read(magic, 4);
+	bool binaryInstance = inputFile && std::memcmp(magic, binaryInstanceMagic, 4) == 0;
+	if (binaryInstance)
+	{
+		readBinaryInstance(inputFile);
+	}
+	else
+	{
+		inputFile.clear();
+		inputFile.seekg(0);
+	}
+	if (!binaryInstance)
 	{
 		for (inputFile >> content; content != "EOF"; inputFile >> content)
 		{
@@ -53,6 +88,38 @@ Data::Data(char * argv[])
 				{
 					inputFile >> content2 >> meanServiceTimeAtClient;
 				}
+			else if (content == "TIME_SLOT_LENGTH")
+				{
+					inputFile >> content2 >> timeSlotLength;
+				}
+			else if (content == "NUMBER_TIME_SLOTS")
+				{
+					inputFile >> content2 >> nbTimeSlots;
+				}
+			else if (content == "NUMBER_ARRIVAL_RATES")
+				{
+					inputFile >> content2 >> nbArrivalRates;
+				}
+			else if (content == "ARRIVAL_RATE_SECTION")
+				{
+					// Each line gives the start time of a segment (in seconds) and the mean inter arrival time from then on
+					for (int i = 0; i < nbArrivalRates; i++)
+					{
+						double startTime, meanInterArrivalTime;
+						inputFile >> startTime >> meanInterArrivalTime;
+						arrivalProfile.addSegment(startTime, meanInterArrivalTime);
+					}
+				}
+			else if (content == "CLIENT_WEIGHT_SECTION")
+				{
+					// Reading the relative demand of each client
+					clientWeights = std::vector<double>(nbClients);
+					for (int i = 0; i < nbClients; i++)
+					{
+						int clientID;
+						inputFile >> clientID >> clientWeights[i];
+					}
+				}
 			else if (content == "WAREHOUSE_SECTION")
 				{
 					// Reading warehouse data
@@ -78,7 +145,7 @@ Data::Data(char * argv[])
 				}
 			else if (content == "EDGE_WEIGHT_SECTION")
 				{
-					travelTime = Matrix(nbClients, nbWarehouses);
+					travelTime = TimeDependentMatrix(nbClients, nbWarehouses);
 					for (int i = 0; i < nbClients; i++)
 					{
 						for (int j = 0; j < nbWarehouses; j++)
@@ -90,9 +157,134 @@ Data::Data(char * argv[])
 						}
 					}
 				}
+			else if (content == "TIME_DEPENDENT_EDGE_WEIGHT_SECTION")
+				{
+					// One matrix per time slot, each preceded by "SLOT index". Identical slots are only stored once
+					travelTime = TimeDependentMatrix(nbClients, nbWarehouses, timeSlotLength);
+					std::vector<int> slice(nbClients * nbWarehouses);
+					for (int s = 0; s < nbTimeSlots; s++)
+					{
+						int slotIndex;
+						inputFile >> content2 >> slotIndex;
+						if (content2 != "SLOT" || slotIndex != s) throw std::runtime_error("Expected travel times of time slot " + std::to_string(s));
+						for (int i = 0; i < nbClients * nbWarehouses; i++)
+						{
+							inputFile >> slice[i];
+						}
+						travelTime.addSlot(slice);
+					}
+					std::cout << "----- Travel times in " << travelTime.nbSlots() << " time slots of " << timeSlotLength << " seconds (" << travelTime.nbDistinctSlices() << " distinct) -----" << std::endl;
+				}
 		}
 	}
 
+	// Without a profile in the instance, orders arrive with the given inter arrival time for 4 hours and every 15 seconds afterwards
+	if (arrivalProfile.nbSegments() == 0)
+	{
+		arrivalProfile.addSegment(0, interArrivalTime);
+		arrivalProfile.addSegment(4*3600, 15);
+	}
+	else
+	{
+		std::cout << "----- Arrival rate profile with " << arrivalProfile.nbSegments() << " segments -----" << std::endl;
+	}
+	// Without weights in the instance, each client is equally likely
+	if (clientWeights.empty())
+	{
+		clientWeights = std::vector<double>(nbClients, 1.0);
+	}
+	clientSampler = AliasTable(clientWeights);
+
+	// With --isochrones=<seconds>, a warehouse only serves the clients in its zone of this travel time
+	if (hasOption("isochrones"))
+	{
+		isochrones.load(getOption("isochroneDirectory", "data/warehouseIsochrones"), (int)getOption("isochrones", 900.0), nbWarehouses);
+		clientZones = std::vector<uint64_t>(nbClients);
+		int nbClientsServed = 0;
+		for (int i = 0; i < nbClients; i++)
+		{
+			clientZones[i] = isochrones.zonesContaining(paramClients[i].lon, paramClients[i].lat);
+			if (clientZones[i] != 0) nbClientsServed++;
+		}
+		std::cout << "----- Service zones of " << isochrones.getSeconds() << " seconds: " << nbClientsServed << " of " << nbClients << " clients in at least one zone -----" << std::endl;
+	}
+
+}
+
+void Data::readBinaryInstance(std::istream& inputFile)
+{
+	// The layout is described in BinaryInstance.h, the magic number has already been read
+	auto read = [&inputFile](void* destination, size_t size)
+	{
+		inputFile.read((char*)destination, size);
+		if (!inputFile) throw std::runtime_error("Binary instance is truncated");
+	};
+	uint32_t version, nameLength;
+	read(&version, sizeof(uint32_t));
+	if (version != binaryInstanceVersion) throw std::runtime_error("Binary instance has version " + std::to_string(version) + ", expected " + std::to_string(binaryInstanceVersion));
+	read(&nameLength, sizeof(uint32_t));
+	std::string name(nameLength, ' ');
+	read(&name[0], nameLength);
+
+	int32_t sizes[2];
+	read(sizes, sizeof(sizes));
+	nbClients = sizes[0];
+	nbWarehouses = sizes[1];
+	read(&meanCommissionTime, sizeof(double));
+	read(&meanServiceTimeAtClient, sizeof(double));
+
+	paramWarehouses.resize(nbWarehouses);
+	for (int i = 0; i < nbWarehouses; i++)
+	{
+		int32_t id, counts[2];
+		read(&id, sizeof(int32_t));
+		read(&paramWarehouses[i].lon, sizeof(double));
+		read(&paramWarehouses[i].lat, sizeof(double));
+		read(counts, sizeof(counts));
+		paramWarehouses[i].wareID = id;
+		paramWarehouses[i].initialNbCouriers = counts[0];
+		paramWarehouses[i].initialNbPickers = counts[1];
+		nbCouriers += counts[0];
+		nbPickers += counts[1];
+	}
+
+	paramClients.resize(nbClients);
+	for (int i = 0; i < nbClients; i++)
+	{
+		int32_t id;
+		read(&id, sizeof(int32_t));
+		read(&paramClients[i].lon, sizeof(double));
+		read(&paramClients[i].lat, sizeof(double));
+		paramClients[i].clientID = id;
+	}
+
+	// The travel times are read in one block
+	std::vector<int32_t> travelTimes((size_t)nbClients * nbWarehouses);
+	read(travelTimes.data(), travelTimes.size() * sizeof(int32_t));
+	travelTime = TimeDependentMatrix(nbClients, nbWarehouses);
+	for (int i = 0; i < nbClients; i++)
+	{
+		for (int j = 0; j < nbWarehouses; j++)
+		{
+			travelTime.set(i, j, travelTimes[(size_t)i * nbWarehouses + j]);
+		}
+	}
+	std::cout << "----- Binary instance " << name << " with " << nbClients << " Clients, " << nbWarehouses << " Warehouses -----" << std::endl;
+}
+
+bool Data::hasOption(const std::string& name) const
+{
+	return options.find(name) != options.end();
 }
 
+std::string Data::getOption(const std::string& name, const std::string& defaultValue) const
+{
+	auto option = options.find(name);
+	return option == options.end() ? defaultValue : option->second;
+}
 
+double Data::getOption(const std::string& name, double defaultValue) const
+{
+	auto option = options.find(name);
+	return option == options.end() ? defaultValue : std::stod(option->second);
+}
@@ -4,12 +4,18 @@
 #include <assert.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <limits.h>
 #include <iostream>
 #include <ctime>
 #include <chrono>
+#include <fstream>
 
 #include "Matrix.h"
+#include "TimeDependentMatrix.h"
+#include "ArrivalProcess.h"
+#include "IsochroneIndex.h"
+#include "OrderQueue.h"
 #include "Data.h"
 #include "xorshift128.h"
 
@@ -33,7 +39,7 @@ struct Warehouse
 	int initialNbPickers;								// Initial number of pickers
 	std::vector< Courier*> couriersAssigned; 			// vector of pointers to couriers which are assigned to the warehouse
 	std::vector< Picker*> pickersAssigned; 				// vector of pointers to pickers which are assigned to the warehouse
-	std::vector< Order*> ordersNotAssignedToCourier;	// vector to orders that are assigned to the warehouse, but not to a courier yet
+	OrderQueue<Order> ordersNotAssignedToCourier;		// FIFO backlog of orders that are assigned to the warehouse, but not to a courier yet
 	double lat;											// Latitude
 	double lon;											// Longitude 
 };
@@ -52,6 +58,7 @@ struct Order
 	int timeToComission;			// Time it takes to comission the order
 	int serviceTimeAtClient;		// Time it takes to serve the client at the door
 	int arrivalTime;				// time the courier arrives at the client, i.e., the client is served
+	long long backlogHandle;		// handle of the order in the backlog of its warehouse (-1 if not waiting for a courier)
 };
 
 // Structure of a route. This is stored mainly for plotting purposes later on
@@ -74,6 +81,7 @@ struct Courier
 	int timeWhenAvailable; 					// Gives the time when the courier is available again, i.e., he is (back) at a warehouse
 	Order* assignedToOrder;					// pointer to order to which the courier is assigned to
 	Warehouse* assignedToWarehouse;			// Warehouse where the courier is located or where he is heading to
+	int assignedSince;						// Time from which the courier counts for assignedToWarehouse (the time he left the client when he was repositioned)
 };
 
 // Structure of a Courier, including its index, position, etc.
@@ -87,7 +95,16 @@ struct Picker
 class Data
 {
 public:
-	Data(char * argv[]);
+	// Constructor: reads the instance file argv[1], with the penalty argv[3] and the inter arrival time argv[4]
+	Data(char * argv[], const std::map<std::string, std::string>& options = {});
+	// Constructor: reads an instance (text or binary format) from a stream, e.g., from memory
+	Data(std::istream& instance, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options = {});
+
+	// Functions that return an optional parameter (given as --name=value), or the default value if it was not given
+	bool hasOption(const std::string& name) const;
+	std::string getOption(const std::string& name, const std::string& defaultValue) const;
+	double getOption(const std::string& name, double defaultValue) const;
+
 	// Data of the problem instance
 	int nbClients;							// Number of clients
 	int nbWarehouses;						// Number of warehouses
@@ -95,12 +112,29 @@ public:
 	int nbPickers;							// Total number of pickers
 	int penaltyForNotServing;				// Penalty for not serving (rejecting) an order. In seconds!
 	double interArrivalTime;				// Inter arrival time of incoming orders
+	int nbArrivalRates;						// Number of segments of the arrival rate profile given in the instance (0 if none)
+	ArrivalProfile arrivalProfile;			// Mean inter arrival time of incoming orders over the day
+	std::vector<double> clientWeights;		// Relative demand of each client (all 1 if not given in the instance)
+	AliasTable clientSampler;				// Draws the client of an incoming order proportional to clientWeights
 	double meanCommissionTime;				// Mean time it takes to commission an order (exponential distributed)
 	double meanServiceTimeAtClient;			// Mean time it takes to serivce an order (at the client) (exponential distributed)
 	std::vector<Client> paramClients;		// Vector containing information on each client
 	std::vector<Warehouse> paramWarehouses;	// Vector containing information on each warehouse
-	Matrix travelTime;						// Distance matrix from clients to warehouses (symetric)
-	XorShift128 rng;						// Fast random number generator
+	int timeSlotLength;						// Length of a time slot of the travel times (in seconds)
+	int nbTimeSlots;						// Number of time slots of the travel times (1 if they do not change over the day)
+	TimeDependentMatrix travelTime;			// Distance matrix from clients to warehouses (symetric), per time slot
+	IsochroneIndex isochrones;				// Service zones of the warehouses (empty if --isochrones is not given)
+	std::vector<uint64_t> clientZones;		// For each client, bit w is set if the zone of warehouse w contains it (empty if all warehouses serve all clients)
+	XorShift128 rng;						// Fast random number generator, each environment starts from a copy of it
+	std::vector<std::string> arguments;		// Positional arguments of the program, starting with the program (empty if not read from the command line)
+	std::string commandLine;				// Same, separated by spaces
+	std::map<std::string, std::string> options;	// Optional parameters given as --name=value
+
+private:
+	// Function that reads an instance in the text format or in the binary format of the instance builder
+	void readInstance(std::istream& inputFile, int penaltyForNotServing, double interArrivalTime);
+	// Function that reads an instance in the binary format of the instance builder (see BinaryInstance.h), after its magic number
+	void readBinaryInstance(std::istream& inputFile);
 };
 
 
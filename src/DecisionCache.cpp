@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+#include "DecisionCache.h"
+
+
+void DecisionCacheStatistics::merge(const DecisionCacheStatistics& other)
+{
+    nbHits += other.nbHits;
+    nbMisses += other.nbMisses;
+    nbVerified += other.nbVerified;
+    nbMismatches += other.nbMismatches;
+    hitTime += other.hitTime;
+    missTime += other.missTime;
+}
+
+std::string DecisionCacheStatistics::describe() const
+{
+    long long nbDecisions = nbHits + nbMisses;
+    double meanHitTime = nbHits > 0 ? hitTime / nbHits : 0.0;
+    double meanMissTime = nbMisses > 0 ? missTime / nbMisses : 0.0;
+    std::ostringstream text;
+    text << "Decision cache hits: " << nbHits << " of " << nbDecisions << " (" << (nbDecisions > 0 ? 100.0 * nbHits / nbDecisions : 0.0) << "%)"
+         << " Mean hit time: " << 1e6 * meanHitTime << " us. Mean miss time: " << 1e6 * meanMissTime << " us."
+         << " Saved decision time: " << nbHits * (meanMissTime - meanHitTime) << " s.";
+    if (nbVerified > 0)
+    {
+        text << " Verified hits with another action: " << nbMismatches << " of " << nbVerified;
+    }
+    return text.str();
+}
+
+DecisionCache::DecisionCache(size_t capacity, int nbShards) : nbEvictions(0)
+{
+    size_t nbPowerOfTwo = 1;
+    while (nbPowerOfTwo < (size_t)std::max(1, nbShards))
+    {
+        nbPowerOfTwo *= 2;
+    }
+    shardCapacity = std::max<size_t>(1, (capacity + nbPowerOfTwo - 1) / nbPowerOfTwo);
+    for (size_t s = 0; s < nbPowerOfTwo; s++)
+    {
+        shards.emplace_back(new Shard());
+        shards.back()->entries.reserve(shardCapacity);
+    }
+}
+
+size_t DecisionCache::KeyHash::operator()(const std::vector<int>& key) const
+{
+    // FNV-1a over the values, followed by a final mix so the high bits that select the shard depend on all values
+    uint64_t hash = 14695981039346656037ULL;
+    for (int value : key)
+    {
+        hash = (hash ^ (uint32_t)value) * 1099511628211ULL;
+    }
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 32;
+    return (size_t)hash;
+}
+
+bool DecisionCache::find(const std::vector<int>& key, int& action)
+{
+    Shard& shard = shardOf(KeyHash()(key));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto entry = shard.entries.find(key);
+    if (entry == shard.entries.end()) return false;
+    shard.usage.splice(shard.usage.begin(), shard.usage, entry->second.usage);
+    action = entry->second.action;
+    return true;
+}
+
+void DecisionCache::insert(const std::vector<int>& key, int action)
+{
+    Shard& shard = shardOf(KeyHash()(key));
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto entry = shard.entries.find(key);
+    if (entry != shard.entries.end())
+    {
+        entry->second.action = action;
+        shard.usage.splice(shard.usage.begin(), shard.usage, entry->second.usage);
+        return;
+    }
+    if (shard.entries.size() >= shardCapacity)
+    {
+        shard.entries.erase(shard.entries.find(*shard.usage.back()));
+        shard.usage.pop_back();
+        nbEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    // The usage list points to the key stored in the map, whose address does not change when the map grows
+    entry = shard.entries.emplace(key, Entry{action, shard.usage.end()}).first;
+    shard.usage.push_front(&entry->first);
+    entry->second.usage = shard.usage.begin();
+}
+
+void DecisionCache::clear()
+{
+    for (auto& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->entries.clear();
+        shard->usage.clear();
+    }
+}
+
+size_t DecisionCache::size() const
+{
+    size_t nbEntries = 0;
+    for (const auto& shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        nbEntries += shard->entries.size();
+    }
+    return nbEntries;
+}
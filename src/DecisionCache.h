@@ -0,0 +1,76 @@
+#ifndef DECISIONCACHE_H
+#define DECISIONCACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Counters of the decisions that went through a DecisionCache. Plain data, so they can be copied into the shared records of the replications
+struct DecisionCacheStatistics
+{
+	long long nbHits;				// Decisions answered from the cache
+	long long nbMisses;				// Decisions that evaluated the policy net and were added to the cache
+	long long nbVerified;			// Hits that also evaluated the policy net (--decisionCacheVerify), and the ones where it chose another action
+	long long nbMismatches;
+	double hitTime;					// Total time of the hits and of the misses (in seconds)
+	double missTime;
+
+	DecisionCacheStatistics() : nbHits(0), nbMisses(0), nbVerified(0), nbMismatches(0), hitTime(0.0), missTime(0.0) {}
+
+	// Function that adds the counters of other
+	void merge(const DecisionCacheStatistics& other);
+	// Function that describes the hit rate, the decision times and the mismatches in one line
+	std::string describe() const;
+};
+
+// Bounded map from the quantized input of a decision (e.g., the client and the load of the warehouses) to the action the policy chose for it.
+// The entries are spread over shards by the hash of their key, and each shard has its own lock and evicts its least recently used entry when
+// it is full, so threads that share the cache rarely wait for each other. Cached actions are only valid for one policy: clear the cache when
+// the policy changes
+class DecisionCache
+{
+public:
+	// Constructor: a cache of at most capacity entries in nbShards shards (rounded up to a power of two)
+	DecisionCache(size_t capacity, int nbShards);
+
+	// Function that returns true and writes the cached action of key if there is one, and marks it as the most recently used
+	bool find(const std::vector<int>& key, int& action);
+	// Function that adds (or replaces) the action of key, evicting the least recently used entry of its shard if it is full
+	void insert(const std::vector<int>& key, int action);
+	// Function that removes all entries
+	void clear();
+
+	size_t size() const;
+	size_t getCapacity() const { return shardCapacity * shards.size(); }
+	long long getNbEvictions() const { return nbEvictions.load(std::memory_order_relaxed); }
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const std::vector<int>& key) const;
+	};
+	typedef std::list<const std::vector<int>*> UsageList;
+	struct Entry
+	{
+		int action;							// Cached action
+		UsageList::iterator usage;			// Position of the key in the usage list of the shard
+	};
+	struct Shard
+	{
+		mutable std::mutex mutex;
+		std::unordered_map<std::vector<int>, Entry, KeyHash> entries;
+		UsageList usage;					// Keys of the entries, the most recently used first
+	};
+
+	std::vector<std::unique_ptr<Shard>> shards;		// Shards of the cache
+	size_t shardCapacity;							// Maximum number of entries of a shard
+	std::atomic<long long> nbEvictions;				// Entries evicted since the cache was created
+
+	Shard& shardOf(size_t hash) { return *shards[(hash >> 16) & (shards.size() - 1)]; }
+};
+
+#endif
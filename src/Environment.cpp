@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <set>
+#include <sstream>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -7,17 +8,97 @@
 #include <cmath>
 #include <cstdio>
 #include <random>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <torch/torch.h>
 #include <torch/script.h>
 #include "Data.h"
 #include "Matrix.h"
 #include "Environment.h"
+#include "BoundedQueue.h"
+#include "AuctionSolver.h"
+#include "ResultsStore.h"
+#include "Sampling.h"
+#include "ThreadManager.h"
+#include "ThreadPool.h"
+#include "WarehouseKernels.h"
 
 
-Environment::Environment(Data* data) : data(data)
+Environment::Environment(Data* data) : data(data), rng(data->rng), nbCandidateWarehousesInBatch(3), maxBidsPerBatch(1000000), batchTimeBudget(0.005), arrivalChunkSize(4096),
+    repositioning(*data), trainRepositioning(false), episodeCounter(0)
 {   
     std::cout<<"----- Create Environment -----"<<std::endl;
+    storage = data->hasOption("streaming") ? STORE_STATISTICS : STORE_ALL;
+    episodeStorage = STORE_ALL;
+    observeEpisode = true;
+    targetHalfWidth = data->getOption("targetHalfWidth", 0.0);
+    minEpochs = data->getOption("minEpochs", 30.0);
+    maxEpochs = data->getOption("maxEpochs", 1000.0);
+    compareWithBaseline = data->hasOption("baseline");
+    mixedPrecision = data->hasOption("mixedPrecision");
+    nbPolicyWarehouses = std::max(data->nbWarehouses, (int)data->getOption("policyWarehouses", 0.0));
+    rolloutHorizon = data->getOption("rolloutHorizon", 600.0);
+    nbRolloutCandidates = data->getOption("rolloutCandidates", 3.0);
+    maxRolloutScenarios = data->getOption("rolloutScenarios", 16.0);
+    rolloutTimeBudget = data->getOption("rolloutBudget", 0.01);
+    nbRolloutThreads = std::max(0, (int)data->getOption("rolloutThreads", 0.0));
+    if (data->getOption("decisionCache", 0.0) > 0){
+        decisionCache = std::make_shared<DecisionCache>((size_t)data->getOption("decisionCache", 0.0), (int)data->getOption("decisionCacheShards", 16.0));
+    }
+    // With the default quantum of one second the key is the exact state, so a hit is the action the net would choose, whichever episode cached it
+    decisionCacheQuantum = std::max(1, (int)data->getOption("decisionCacheQuantum", 1.0));
+    decisionCacheVerify = std::max(0, (int)data->getOption("decisionCacheVerify", 0.0));
+    // The instance seeds its generator with 0 when it is read, the actor-learner training and the replications use their own seeds
+    runSeed = "0";
+    selectWarehouseKernels();
+
+    // All environments of the process (e.g., the actors of the actor-learner training) add to the same metrics
+    MetricsRegistry& metrics = MetricsRegistry::global();
+    measureDecisionLatency = data->hasOption("metricsFile") || data->hasOption("metricsPort");
+    episodesMetric = &metrics.counter("onlineassignment_episodes", "Simulated episodes (epochs)", true);
+    eventsMetric = &metrics.counter("onlineassignment_events", "Simulation events (order arrivals and deliveries)", true);
+    ordersMetric = &metrics.counter("onlineassignment_orders", "Arrived orders");
+    rejectedOrdersMetric = &metrics.counter("onlineassignment_rejected_orders", "Rejected orders");
+    episodeCostsMetric = &metrics.gauge("onlineassignment_episode_costs", "Costs of the last episode");
+    rejectionRateMetric = &metrics.gauge("onlineassignment_rejection_rate", "Share of rejected orders of the last episode");
+    averageCostsMetric = &metrics.gauge("onlineassignment_average_costs", "Average costs of the current training window of 100 epochs or of the evaluation so far");
+    maxBacklogMetric = &metrics.gauge("onlineassignment_max_backlog", "Highest number of orders waiting for a courier at one warehouse in the last episode");
+    lossMetric = &metrics.gauge("onlineassignment_loss", "Loss of the last update of the policy net");
+    decisionLatencyMetric = &metrics.histogram("onlineassignment_decision_latency_seconds", "Time of an assignment decision (a batch window counts once)",
+        {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1});
+    decisionLatencyCounts = std::vector<uint64_t>(decisionLatencyMetric->getNbBuckets(), 0);
+    decisionLatencySum = 0.0;
+}
+
+template <int N>
+void Environment::useWarehouseKernels()
+{
+    stateKernel = &Environment::buildStateAssignmentProblem<N>;
+}
+
+void Environment::selectWarehouseKernels()
+{
+    // Our instances have 10 warehouses, the other sizes are compiled for smaller and larger store networks
+    switch (data->nbWarehouses){
+        case 5: useWarehouseKernels<5>(); break;
+        case 10: useWarehouseKernels<10>(); break;
+        case 15: useWarehouseKernels<15>(); break;
+        case 20: useWarehouseKernels<20>(); break;
+        default: useWarehouseKernels<0>(); break;
+    }
+}
+
+Environment::~Environment()
+{
+    clearEpisode();
 }
 
 
@@ -33,33 +114,25 @@ void Environment::initialize(int timeLimit)
     nbOrdersServed = 0;
     rejectCount = 0;
     nextOrderBeingServed = nullptr;
+    episodeCounter++;
+    rolloutSeed = episodeCounter;
+    assingmentProblemStates = torch::Tensor();
+    assingmentProblemActions = torch::Tensor();
+    assignmentProblemMasks = torch::Tensor();
+    assignmentProblemOrders.clear();
+    // A learned repositioning policy is loaded with the first episode, unless the training sets the net it learns
+    if (repositioning.needsNet()){
+        repositioning.loadNet(repositioning.getNetFileName());
+        std::cout<<"----- Repositioning net loaded from " << repositioning.getNetFileName() << " -----"<<std::endl;
+    }
+    repositioningStates.clear();
+    repositioningActions.clear();
+    repositioningTimes.clear();
+    repositioningWarehouses.clear();
     
-    for (size_t ord=0; ord<ordersAssignedToCourierButNotServed.size(); ord++) {
-			delete ordersAssignedToCourierButNotServed[ord];
-	}
-    ordersAssignedToCourierButNotServed = std::vector<Order*>(0);
-    
-    for (size_t ord=0; ord<couriers.size(); ord++) {
-		delete couriers[ord];
-	}
-    couriers = std::vector<Courier*>(0);
-	
-    for (size_t ord=0; ord<pickers.size(); ord++) {
-		delete pickers[ord];
-	}
-    pickers = std::vector<Picker*>(0);
-
-	for (size_t ord=0; ord<orders.size(); ord++) {
-		delete orders[ord];
-	}
-    orders = std::vector<Order*>(0);
-	
-    for (size_t ord=0; ord<routes.size(); ord++) {
-		delete routes[ord];
-	}
-    routes = std::vector<Route*>(0);
-
-    warehouses = std::vector<Warehouse*>(0);
+    // The last episode is freed according to what it kept, which may differ from what the next one keeps (e.g., after training)
+    clearEpisode();
+    episodeStorage = storage;
 
     for (int wID = 0; wID < data->nbWarehouses; wID++)
     {
@@ -70,7 +143,7 @@ void Environment::initialize(int timeLimit)
         newWarehouse->lon = data->paramWarehouses[wID].lon;
         newWarehouse->initialNbCouriers = data->paramWarehouses[wID].initialNbCouriers;
         newWarehouse->initialNbPickers = data->paramWarehouses[wID].initialNbPickers;
-        newWarehouse->ordersNotAssignedToCourier = std::vector<Order*>(0);
+        newWarehouse->ordersNotAssignedToCourier.clear();
         for (int cID = 0; cID < newWarehouse->initialNbCouriers; cID++)
         {
             Courier* newCourier = new Courier;
@@ -78,6 +151,7 @@ void Environment::initialize(int timeLimit)
             newCourier->assignedToWarehouse = warehouses[wID];
             newCourier->assignedToOrder = nullptr;
             newCourier->timeWhenAvailable = 0;
+            newCourier->assignedSince = 0;
             couriers.push_back(newCourier);
             newWarehouse->couriersAssigned.push_back(newCourier);
             courierCounter ++;    
@@ -94,36 +168,171 @@ void Environment::initialize(int timeLimit)
         }
     }
 
-    // Now we draw the random numbers
+    // Now we draw the random numbers. In streaming mode, only a first chunk is drawn, the rest follows while the simulation runs
     orderTimes = std::vector<int>(0);
     clientsVector = std::vector<int>(0);
     timesToComission = std::vector<int>(0);
     timesToServe = std::vector<int>(0);
-    int currTime = 0;
-    int nextTime;
-    while (currTime < timeLimit){
-        nextTime = drawFromExponentialDistribution(data->interArrivalTime);
-        currTime += nextTime;
-        if(currTime > 4*3600){
-            data->interArrivalTime = 15; 
-        }
-        orderTimes.push_back(nextTime);
-        clientsVector.push_back(data->rng() % data->nbClients);
+    arrivalOffset = 0;
+    arrivalDrawTime = 0;
+    arrivalClock = 0.0;
+    allArrivalsDrawn = false;
+    nbOrdersArrived = 0;
+    nbOrdersAccepted = 0;
+    objValueOfFinishedOrders = 0;
+    waitingTimes.clear();
+    warehouseStatistics = std::vector<WarehouseStatistics>(data->nbWarehouses);
+    // Arrivals are drawn in chunks in both modes, so a simulation draws the same random numbers with and without streaming
+    drawArrivals(timeLimit, arrivalChunkSize);
+    while (episodeStorage != STORE_STATISTICS && !allArrivalsDrawn){
+        drawArrivals(timeLimit, arrivalChunkSize);
+    }
+}
+
+void Environment::drawArrivals(int timeLimit, size_t nbArrivals)
+{
+    // The arrivals of a chunk are drawn as a batch: first their times from the arrival rate profile, then their clients with the alias method,
+    // then their comission and service times. Only the arrivals up to the first one beyond timeLimit are kept
+    arrivalTimesBuffer.clear();
+    data->arrivalProfile.drawArrivalTimes(arrivalClock, nbArrivals, rng, arrivalTimesBuffer);
+    size_t nbKept = 0;
+    while (nbKept < arrivalTimesBuffer.size() && (nbKept == 0 ? arrivalClock : arrivalTimesBuffer[nbKept - 1]) < timeLimit){
+        nbKept++;
+    }
+    for (size_t a = 0; a < nbKept; a++){
+        // An arrival that never happens (no demand at the end of the profile) is only used to end the episode
+        int arrivalTime = std::lround(std::min(arrivalTimesBuffer[a], (double)INT_MAX / 2));
+        orderTimes.push_back(arrivalTime - arrivalDrawTime);
+        arrivalDrawTime = arrivalTime;
+    }
+    if (nbKept > 0){
+        arrivalClock = arrivalTimesBuffer[nbKept - 1];
+    }
+    for (size_t a = 0; a < nbKept; a++){
+        clientsVector.push_back(data->clientSampler.sample(rng));
+    }
+    for (size_t a = 0; a < nbKept; a++){
         timesToComission.push_back(drawFromExponentialDistribution(data->meanCommissionTime));
+    }
+    for (size_t a = 0; a < nbKept; a++){
         timesToServe.push_back(drawFromExponentialDistribution(data->meanServiceTimeAtClient));
     }
+    allArrivalsDrawn = arrivalClock >= timeLimit;
+}
+
+void Environment::ensureArrivalsDrawn(int timeLimit, size_t counter)
+{
+    // The simulation needs to know whether the arrival after counter exists, so at least two arrivals from counter on have to be drawn
+    if (allArrivalsDrawn || getNbArrivalsDrawn() > counter + 1){
+        return;
+    }
+    // Arrivals before counter are not needed anymore, as orders copy their values when they arrive
+    size_t nbConsumed = counter - arrivalOffset;
+    orderTimes.erase(orderTimes.begin(), orderTimes.begin() + nbConsumed);
+    clientsVector.erase(clientsVector.begin(), clientsVector.begin() + nbConsumed);
+    timesToComission.erase(timesToComission.begin(), timesToComission.begin() + nbConsumed);
+    timesToServe.erase(timesToServe.begin(), timesToServe.begin() + nbConsumed);
+    arrivalOffset = counter;
+    drawArrivals(timeLimit, arrivalChunkSize);
+}
+
+size_t Environment::getNbArrivalsDrawn()
+{
+    return arrivalOffset + orderTimes.size();
+}
+
+void Environment::clearEpisode()
+{
+    // Every order of the episode is contained in orders, so the other vectors of orders only need to be emptied.
+    // In streaming mode, finished orders have been freed already and the remaining ones are only contained in these vectors
+    if (episodeStorage == STORE_STATISTICS){
+        for (size_t ord=0; ord<ordersAssignedToCourierButNotServed.size(); ord++) {
+            delete ordersAssignedToCourierButNotServed[ord];
+        }
+        for (size_t ord=0; ord<ordersInBatch.size(); ord++) {
+            delete ordersInBatch[ord];
+        }
+        for (size_t w=0; w<warehouses.size(); w++) {
+            for (Order* order : warehouses[w]->ordersNotAssignedToCourier) {
+                delete order;
+            }
+        }
+    }
+    ordersAssignedToCourierButNotServed = std::vector<Order*>(0);
+    ordersInBatch = std::vector<Order*>(0);
+
+    for (size_t ord=0; ord<couriers.size(); ord++) {
+        delete couriers[ord];
+    }
+    couriers = std::vector<Courier*>(0);
+
+    for (size_t ord=0; ord<pickers.size(); ord++) {
+        delete pickers[ord];
+    }
+    pickers = std::vector<Picker*>(0);
+
+    for (size_t ord=0; ord<orders.size(); ord++) {
+        delete orders[ord];
+    }
+    orders = std::vector<Order*>(0);
+
+    for (size_t ord=0; ord<routes.size(); ord++) {
+        delete routes[ord];
+    }
+    routes = std::vector<Route*>(0);
+
+    for (size_t ord=0; ord<warehouses.size(); ord++) {
+        delete warehouses[ord];
+    }
+    warehouses = std::vector<Warehouse*>(0);
+}
+
+void Environment::loadTrainingInstances()
+{
+    std::stringstream fileNames(data->getOption("trainInstances", ""));
+    std::string fileName;
+    while (std::getline(fileNames, fileName, ',')){
+        if (fileName.empty()) continue;
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file){
+            throw std::runtime_error("Could not open training instance " + fileName);
+        }
+        trainingInstances.emplace_back(new Data(file, data->penaltyForNotServing, data->interArrivalTime, data->options));
+        nbPolicyWarehouses = std::max(nbPolicyWarehouses, trainingInstances.back()->nbWarehouses);
+    }
+    if (trainingInstances.empty()){
+        throw std::invalid_argument("No training instance given in --trainInstances");
+    }
+    std::cout<<"----- " << trainingInstances.size() << " training instances loaded, the policy net has " << nbPolicyWarehouses << " warehouses -----"<<std::endl;
+}
+
+void Environment::useInstance(Data* instance)
+{
+    if (instance == data) return;
+    data = instance;
+    selectWarehouseKernels();
+}
+
+void Environment::logEvent(EventType type, int order, int warehouse, int agent, int value)
+{
+    if (eventLog && observeEpisode){
+        eventLog->record(type, currentTime, order, warehouse, agent, value);
+    }
 }
 
 void Environment::initOrder(int currentTime, Order* o)
 {
-    o->orderID = orders.size();
-    o->timeToComission = timesToComission[o->orderID]; // Follows expoential distribution
+    o->orderID = nbOrdersArrived;
+    nbOrdersArrived++;
+    o->timeToComission = timesToComission[o->orderID - arrivalOffset]; // Follows expoential distribution
+    o->serviceTimeAtClient = timesToServe[o->orderID - arrivalOffset]; // Follows expoential distribution
     o->assignedCourier = nullptr;
     o->assignedPicker = nullptr;
     o->assignedWarehouse = nullptr;
-    o->client = &data->paramClients[clientsVector[o->orderID]];
+    o->client = &data->paramClients[clientsVector[o->orderID - arrivalOffset]];
     o->orderTime = currentTime;
     o->arrivalTime = -1;
+    o->backlogHandle = -1;
 }
 
 int Environment::drawFromExponentialDistribution(double lambda)
@@ -131,7 +340,7 @@ int Environment::drawFromExponentialDistribution(double lambda)
     // Random number generator based on poisson process
     double lambdaInv = 1/lambda;
     std::exponential_distribution<double> exp (lambdaInv);
-    return round(exp.operator() (data->rng));
+    return round(exp.operator() (rng));
 }
 
 void Environment::choosePickerForOrder(Order* newOrder) 
@@ -140,14 +349,16 @@ void Environment::choosePickerForOrder(Order* newOrder)
     newOrder->assignedPicker = getFastestAvailablePicker(newOrder->assignedWarehouse);
     // We set the time the picker is available again to the maximum of either the previous availability time or the current time, plus the time needed to comission the order
     newOrder->assignedPicker->timeWhenAvailable = std::max(newOrder->assignedPicker->timeWhenAvailable, currentTime) + newOrder->timeToComission;
+    warehouseStatistics[newOrder->assignedWarehouse->wareID].pickerBusyTime += newOrder->timeToComission;
 }
 
 void Environment::chooseCourierForOrder(Order* newOrder)
 {
     // We choose the courier who is available fastest
     newOrder->assignedCourier = getFastestAvailableCourier(newOrder->assignedWarehouse);
-    // We set the time the courier is arriving at the order to the maximum of either the current time, or the time the picker or couriers are available (comission time for picker has already been accounted for before). We then add the distance to the warehouse
-    newOrder->arrivalTime = std::max(currentTime, std::max(newOrder->assignedCourier->timeWhenAvailable, newOrder->assignedPicker->timeWhenAvailable)) + data->travelTime.get(newOrder->client->clientID, newOrder->assignedWarehouse->wareID);
+    // We set the time the courier is arriving at the order to the maximum of either the current time, or the time the picker or couriers are available (comission time for picker has already been accounted for before). We then add the distance to the warehouse at the time the courier departs
+    int departureTime = std::max(currentTime, std::max(newOrder->assignedCourier->timeWhenAvailable, newOrder->assignedPicker->timeWhenAvailable));
+    newOrder->arrivalTime = departureTime + data->travelTime.get(newOrder->client->clientID, newOrder->assignedWarehouse->wareID, departureTime);
     newOrder->assignedCourier->assignedToOrder = newOrder;
     if(newOrder->arrivalTime<timeNextCourierArrivesAtOrder){
         timeNextCourierArrivesAtOrder = newOrder->arrivalTime;
@@ -158,29 +369,49 @@ void Environment::chooseCourierForOrder(Order* newOrder)
         latestArrivalTime = newOrder->arrivalTime;
     }
 
-    saveRoute(std::max(currentTime, std::max(newOrder->assignedCourier->timeWhenAvailable, newOrder->assignedPicker->timeWhenAvailable)), newOrder->arrivalTime, newOrder->assignedCourier->assignedToWarehouse->lat, newOrder->assignedCourier->assignedToWarehouse->lon, newOrder->client->lat, newOrder->client->lon);
+    saveRoute(departureTime, newOrder->arrivalTime, newOrder->assignedCourier->assignedToWarehouse->lat, newOrder->assignedCourier->assignedToWarehouse->lon, newOrder->client->lat, newOrder->client->lon);
 
-    // Remove order from vector of orders that have not been assigned to a courier yet (If applicable)   
-    RemoveOrderFromVector(newOrder->assignedWarehouse->ordersNotAssignedToCourier, newOrder);
+    // Remove order from the backlog of orders that have not been assigned to a courier yet (If applicable)
+    if (newOrder->assignedWarehouse->ordersNotAssignedToCourier.remove(newOrder->backlogHandle)){
+        newOrder->backlogHandle = -1;
+    }
+    warehouseStatistics[newOrder->assignedWarehouse->wareID].observeQueueLength(currentTime, newOrder->assignedWarehouse->ordersNotAssignedToCourier.size());
+    warehouseStatistics[newOrder->assignedWarehouse->wareID].courierBusyTime += newOrder->arrivalTime - departureTime;
     // Remove courier from vector of couriers assigned to warehouse
     RemoveCourierFromVector(newOrder->assignedWarehouse->couriersAssigned, newOrder->assignedCourier);
     //newOrder->assignedCourier->assignedToWarehouse = nullptr;
     newOrder->assignedCourier->timeWhenAvailable = currentTime;
+    logEvent(COURIER_ASSIGNED, newOrder->orderID, newOrder->assignedWarehouse->wareID, newOrder->assignedCourier->courierID, newOrder->arrivalTime);
 }
 
 
 void Environment::chooseClosestWarehouseForCourier(Courier* courier)
 {
-    // For now, we just assign the courier back to the warehouse he came from
-    // draw service time needed to serve the client at the door
-    courier->assignedToOrder->serviceTimeAtClient = timesToServe[courier->assignedToOrder->orderID];   
-    // Compute the time the courier is available again, i.e., can leave the warehouse that we just assigned him to
-    courier->timeWhenAvailable = courier->assignedToOrder->arrivalTime + courier->assignedToOrder->serviceTimeAtClient + data->travelTime.get(courier->assignedToOrder->client->clientID, courier->assignedToWarehouse->wareID);
+    // The order is counted for the warehouse that served it, the courier drives back to it or is repositioned to another one
+    Warehouse* servingWarehouse = courier->assignedToWarehouse;
+    // The service time needed to serve the client at the door has been drawn when the order arrived
+    // Compute the time the courier is available again, i.e., can leave the warehouse that we just assigned him to. The travel time is the one at the time he leaves the client
+    int departureTime = courier->assignedToOrder->arrivalTime + courier->assignedToOrder->serviceTimeAtClient;
+    if (repositioning.isActive()){
+        repositionCourier(courier, departureTime);
+    }
+    // A repositioned courier counts for the warehouse he drives to from the time he leaves the client
+    if (courier->assignedToWarehouse != servingWarehouse){
+        warehouseStatistics[servingWarehouse->wareID].addCourierTime(courier->assignedSince, departureTime);
+        courier->assignedSince = departureTime;
+    }
+    courier->timeWhenAvailable = departureTime + data->travelTime.get(courier->assignedToOrder->client->clientID, courier->assignedToWarehouse->wareID, departureTime);
+    logEvent(COURIER_ARRIVAL, courier->assignedToOrder->orderID, courier->assignedToWarehouse->wareID, courier->courierID, courier->timeWhenAvailable);
     // Add the courier to the vector of assigned couriers at the respective warehouse
     courier->assignedToWarehouse->couriersAssigned.push_back(courier);
     // Increment the number of order that have been served
     nbOrdersServed ++;
     totalWaitingTime += courier->assignedToOrder->arrivalTime - courier->assignedToOrder->orderTime;
+    objValueOfFinishedOrders += courier->assignedToOrder->arrivalTime - courier->assignedToOrder->orderTime;
+    waitingTimes.add(courier->assignedToOrder->arrivalTime - courier->assignedToOrder->orderTime);
+    warehouseStatistics[servingWarehouse->wareID].nbOrdersServed++;
+    warehouseStatistics[servingWarehouse->wareID].courierBusyTime += departureTime - courier->assignedToOrder->arrivalTime;
+    warehouseStatistics[courier->assignedToWarehouse->wareID].courierBusyTime += courier->timeWhenAvailable - departureTime;
     if (highestWaitingTimeOfAnOrder < courier->assignedToOrder->arrivalTime - courier->assignedToOrder->orderTime)
     {
         highestWaitingTimeOfAnOrder = courier->assignedToOrder->arrivalTime - courier->assignedToOrder->orderTime;
@@ -195,10 +426,49 @@ void Environment::chooseClosestWarehouseForCourier(Courier* courier)
     RemoveOrderFromVector(ordersAssignedToCourierButNotServed, nextOrderBeingServed);
     // Update the order that will be served next
     updateOrderBeingServedNext();
+    // In streaming mode, the order has been folded into the statistics and is not needed anymore
+    if (episodeStorage == STORE_STATISTICS){
+        delete courier->assignedToOrder;
+    }
     courier->assignedToOrder = nullptr;
 }
 
+void Environment::repositionCourier(Courier* courier, int departureTime)
+{
+    // The backlogs and couriers of the warehouses are kept up to date by the simulation, so a decision reads them without scanning orders or couriers
+    int clientID = courier->assignedToOrder->client->clientID;
+    const int* travelTimes = data->travelTime.getRowData(clientID, departureTime);
+    Warehouse* home = courier->assignedToWarehouse;
+    repositioningNearest.clear();
+    for (int w = 0; w < data->nbWarehouses; w++){
+        if (w != home->wareID) repositioningNearest.push_back(w);
+    }
+    int nbNearest = std::min(repositioning.getNbNearest(), data->nbWarehouses - 1);
+    std::partial_sort(repositioningNearest.begin(), repositioningNearest.begin() + nbNearest, repositioningNearest.end(), [&](int a, int b){ return travelTimes[a] < travelTimes[b]; });
+    repositioningCandidates.clear();
+    for (int c = 0; c <= nbNearest; c++){
+        Warehouse* warehouse = c == 0 ? home : warehouses[repositioningNearest[c - 1]];
+        repositioningCandidates.push_back(RepositioningCandidate{warehouse->wareID, travelTimes[warehouse->wareID], (int)warehouse->ordersNotAssignedToCourier.size(),
+            (int)warehouse->couriersAssigned.size(), warehouse->initialNbCouriers, c == 0});
+    }
+    int chosen = repositioning.choose(repositioningCandidates, trainRepositioning, trainRepositioning ? drawUniform(rng) : 0.0);
+    if (trainRepositioning){
+        for (const RepositioningCandidate& candidate : repositioningCandidates){
+            repositioningStates.resize(repositioningStates.size() + CourierRepositioning::nbFeatures);
+            CourierRepositioning::getFeatures(candidate, &repositioningStates[repositioningStates.size() - CourierRepositioning::nbFeatures]);
+        }
+        repositioningActions.push_back(chosen);
+        repositioningTimes.push_back(departureTime);
+        repositioningWarehouses.push_back(repositioningCandidates[chosen].warehouse);
+    }
+    courier->assignedToWarehouse = warehouses[repositioningCandidates[chosen].warehouse];
+}
+
 void Environment::saveRoute(int startTime, int arrivalTime, double fromLat, double fromLon, double toLat, double toLon){
+    // Routes are only needed for plotting, so they are not kept in streaming mode or in training
+    if (episodeStorage != STORE_ALL){
+        return;
+    }
     Route* route = new Route;
     route->fromLat = fromLat; route->fromLon = fromLon; route->toLat = toLat; route->tolon = toLon;
     route->startTime = startTime;
@@ -243,20 +513,9 @@ void Environment::writeRoutesAndOrdersToFile(std::string fileNameRoutes, std::st
 	else std::cout << "----- IMPOSSIBLE TO OPEN: " << fileNameOrders << std::endl;
 }
 
-int Environment::getObjValue(){
-    int objectiveValue = 0;
-    for (Order* order: orders){
-        if (order->accepted){
-            if (order->arrivalTime == -1){
-                objectiveValue += data->penaltyForNotServing;
-            }else{
-                objectiveValue += (order->arrivalTime-order->orderTime); 
-            }
-        }else{
-            objectiveValue += data->penaltyForNotServing;
-        }
-    } 
-    return objectiveValue;
+long long Environment::getObjValue(){
+    // Served orders count with their waiting time and rejected orders with the penalty when they finish. Accepted orders that have not been served count with the penalty
+    return objValueOfFinishedOrders + (long long)(nbOrdersAccepted - nbOrdersServed) * data->penaltyForNotServing;
 }
 
 void Environment::writeCostsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, float lambdaTemporal, float lambdaSpatial, bool is_training){
@@ -284,9 +543,20 @@ void Environment::writeCostsToFile(std::vector<float> costs, std::vector<float>
 		}
 	}
 	else std::cout << "----- IMPOSSIBLE TO OPEN: " << fileName << std::endl;
+    if (data->hasOption("resultsStore")){
+        // The costs are averages over 100 epochs
+        std::map<std::string, std::string> metadata = getRunMetadata(is_training ? "training" : "evaluation");
+        metadata["lambdaTemporal"] = formatLambda(lambdaTemporal);
+        metadata["lambdaSpatial"] = formatLambda(lambdaSpatial);
+        ResultsWriter results(data->getOption("resultsStore", ""), metadata, {"epoch", "costs", "rejectionRate"});
+        for (size_t i = 0; i < costs.size(); i++){
+            results.addRow({100.0 * (i + 1), costs[i], averageRejectionRateVector[i]});
+        }
+    }
 }
 
-void Environment::writeStatsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, float lambdaTemporal, float lambdaSpatial, bool is_training, bool is_nearest_policy){
+void Environment::writeStatsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, std::vector<std::vector<int>> waitingTimeQuantiles, float lambdaTemporal, float lambdaSpatial, bool is_training, bool is_nearest_policy,
+                                   const std::vector<int>& epochs, const std::vector<int>& seeds){
     std::string fileName;
     if (is_training){
         fileName = "data/experimentData/trainingData/statsData_" + std::to_string(data->penaltyForNotServing) + "_" + std::to_string(data->interArrivalTime) + "_" + std::to_string(lambdaTemporal) + "_" + std::to_string(lambdaSpatial) +".txt";
@@ -298,23 +568,189 @@ void Environment::writeStatsToFile(std::vector<float> costs, std::vector<float>
             fileName = "data/experimentData/testData/statsData_" + std::to_string(data->penaltyForNotServing) + "_" + std::to_string(data->interArrivalTime) + "_"  + std::to_string(lambdaTemporal) + "_" + std::to_string(lambdaSpatial) +".txt";
         }
     }
- 
+    writeStatsToFile(fileName, costs, averageRejectionRateVector, averageWaitingTime, maxWaitingTime, waitingTimeQuantiles, epochs, seeds);
+}
+
+void Environment::writeStatsToFile(std::string fileName, std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, std::vector<std::vector<int>> waitingTimeQuantiles,
+                                   const std::vector<int>& epochs, const std::vector<int>& seeds){
 	std::cout << "----- WRITING COST VECTOR IN : " << fileName << std::endl;
 	std::ofstream myfile(fileName);
 	if (myfile.is_open())
 	{
         int _i = 0;
-        myfile << "TotalCosts " << "RejectionRate " <<"MeanWaitingTime " << "MaxWaitingTime ";
+        myfile << "TotalCosts " << "RejectionRate " <<"MeanWaitingTime " << "MaxWaitingTime " << "P50WaitingTime " << "P90WaitingTime " << "P95WaitingTime " << "P99WaitingTime ";
         myfile << std::endl;
 		for (auto cost : costs)
 		{
             // Here we print the order of customers that we visit 
             myfile << cost << " " << averageRejectionRateVector[_i]<< " " << averageWaitingTime[_i]<< " " << maxWaitingTime[_i];
+            for (int quantile : waitingTimeQuantiles[_i]){
+                myfile << " " << quantile;
+            }
             myfile << std::endl;
             _i += 1;
 		}
 	}
 	else std::cout << "----- IMPOSSIBLE TO OPEN: " << fileName << std::endl;
+    if (data->hasOption("resultsStore")){
+        // Replications have their own seed each, which is a column then
+        std::map<std::string, std::string> metadata = getRunMetadata("evaluation");
+        std::vector<std::string> columns = {"epoch", "costs", "rejectionRate", "meanWaitingTime", "maxWaitingTime", "p50WaitingTime", "p90WaitingTime", "p95WaitingTime", "p99WaitingTime"};
+        if (!seeds.empty()){
+            metadata["seed"] = "column";
+            columns.push_back("seed");
+        }
+        ResultsWriter results(data->getOption("resultsStore", ""), metadata, columns);
+        for (size_t i = 0; i < costs.size(); i++){
+            std::vector<double> row = {epochs.empty() ? i + 1.0 : epochs[i], costs[i], averageRejectionRateVector[i], averageWaitingTime[i], maxWaitingTime[i]};
+            for (int quantile : waitingTimeQuantiles[i]){
+                row.push_back(quantile);
+            }
+            row.resize(9, NAN);
+            if (!seeds.empty()) row.push_back(seeds[i]);
+            results.addRow(row);
+        }
+    }
+}
+
+std::map<std::string, std::string> Environment::getRunMetadata(const std::string& kind){
+    std::map<std::string, std::string> metadata;
+    metadata["kind"] = kind;
+    // The first argument is the program. The arguments are kept as given, so a path with spaces stays one argument
+    const std::vector<std::string>& arguments = data->arguments;
+    const char* names[] = {"instance", "hours", "penalty", "interArrivalTime", "method"};
+    size_t a = 1;
+    for (const char* name : names){
+        if (a < arguments.size()) metadata[name] = arguments[a++];
+    }
+    if (metadata["method"].find("REINFORCE") != std::string::npos){
+        // Lambdas are formatted like the ones of a configuration, a list (of a sweep) is kept as given
+        for (const char* name : {"lambdaTemporal", "lambdaSpatial"}){
+            if (a >= arguments.size()) break;
+            size_t length = 0;
+            try{
+                double lambda = std::stod(arguments[a], &length);
+                metadata[name] = length == arguments[a].size() ? formatLambda(lambda) : arguments[a];
+            }catch (const std::exception&){
+                metadata[name] = arguments[a];
+            }
+            a++;
+        }
+    }
+    for (int i = 0; a < arguments.size(); i++){
+        metadata["argument" + std::to_string(i)] = arguments[a++];
+    }
+    for (const auto& option : data->options){
+        if (option.first != "resultsStore") metadata["--" + option.first] = option.second;
+    }
+    metadata["seed"] = runSeed;
+    metadata["time"] = std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    metadata["pid"] = std::to_string(getpid());
+    return metadata;
+}
+
+std::string Environment::formatLambda(double lambda){
+    // Lambdas are floats, so 6 significant digits give "0.1" for 0.1 whether it was read as a double or as a float
+    std::ostringstream text;
+    text << (float)lambda;
+    return text.str();
+}
+
+std::string Environment::getKpiFileName(const std::string& policy){
+    return "data/experimentData/testData/kpiData_" + std::to_string(data->penaltyForNotServing) + "_" + std::to_string(data->interArrivalTime) + "_" + policy + ".txt";
+}
+
+void Environment::writeKpisToFile(std::string fileName, const WaitingTimeHistogram& allWaitingTimes, const std::vector<WarehouseStatistics>& allWarehouseStatistics){
+    std::cout << "----- WRITING KPIS IN : " << fileName << std::endl;
+    std::ofstream myfile(fileName);
+    if (myfile.is_open())
+    {
+        myfile << "NbOrdersServed " << "MeanWaitingTime " << "P50WaitingTime " << "P90WaitingTime " << "P95WaitingTime " << "P99WaitingTime " << "MaxWaitingTime" << std::endl;
+        myfile << allWaitingTimes.count() << " " << allWaitingTimes.mean() << " " << allWaitingTimes.quantile(0.5) << " " << allWaitingTimes.quantile(0.9) << " " << allWaitingTimes.quantile(0.95) << " " << allWaitingTimes.quantile(0.99) << " " << allWaitingTimes.max() << std::endl;
+        myfile << "Warehouse " << "OrdersAccepted " << "OrdersServed " << "CourierUtilization " << "PickerUtilization " << "MeanQueueLength " << "MaxQueueLength" << std::endl;
+        for (size_t w = 0; w < allWarehouseStatistics.size(); w++)
+        {
+            const WarehouseStatistics& statistics = allWarehouseStatistics[w];
+            myfile << w << " " << statistics.nbOrdersAccepted << " " << statistics.nbOrdersServed << " " << statistics.courierUtilization() << " " << statistics.pickerUtilization() << " " << statistics.meanQueueLength() << " " << statistics.maxQueueLength << std::endl;
+        }
+    }
+    else std::cout << "----- IMPOSSIBLE TO OPEN: " << fileName << std::endl;
+}
+
+void Environment::startEvaluation(){
+    repositioning.resetStatistics();
+    decisionCacheStatistics = DecisionCacheStatistics();
+    costEstimate = RunningEstimate();
+    differenceEstimate = RunningEstimate();
+    baselineEstimate = RunningEstimate();
+    if (targetHalfWidth > 0){
+        std::cout<<"----- Evaluation stops at a 95% confidence half-width of " << 100*targetHalfWidth << "% of the mean costs (" << minEpochs << " to " << maxEpochs << " epochs) -----"<<std::endl;
+    }
+}
+
+void Environment::startScenario(){
+    // The baseline is simulated on the same random numbers (common random numbers), so the difference of the costs has a much lower variance than the costs
+    if (compareWithBaseline){
+        scenarioRng = rng;
+    }
+}
+
+bool Environment::finishScenario(int timeLimit, int epoch, long long objValue){
+    costEstimate.add(objValue);
+    averageCostsMetric->set(costEstimate.mean);
+    if (compareWithBaseline){
+        XorShift128 rngAfterScenario = rng;
+        rng = scenarioRng;
+        // The baseline run is only used for the difference, so the log and the metrics count each scenario once, and the episodes of the
+        // evaluated policy keep their numbers (and the seeds of their rollouts) whether or not a baseline is simulated in between
+        int episodeCounterAfterScenario = episodeCounter;
+        unsigned rolloutSeedAfterScenario = rolloutSeed;
+        observeEpisode = false;
+        initialize(timeLimit);
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseClosestWarehouseForOrder(newOrder); });
+        observeEpisode = true;
+        baselineEstimate.add(getObjValue());
+        differenceEstimate.add(objValue - getObjValue());
+        rng = rngAfterScenario;
+        episodeCounter = episodeCounterAfterScenario;
+        rolloutSeed = rolloutSeedAfterScenario;
+    }
+    if (targetHalfWidth <= 0 || epoch < minEpochs){
+        return true;
+    }
+    // With a baseline, the difference to the baseline has to be precise relative to the costs of the baseline
+    if (compareWithBaseline){
+        return differenceEstimate.halfWidth() > targetHalfWidth * std::abs(baselineEstimate.mean);
+    }
+    return costEstimate.halfWidth() > targetHalfWidth * std::abs(costEstimate.mean);
+}
+
+void Environment::reportEvaluation(){
+    std::cout<< "Mean costs: " << costEstimate.mean << " +- " << costEstimate.halfWidth() << " (95% confidence) after " << costEstimate.count << " epochs" <<std::endl;
+    if (compareWithBaseline){
+        std::cout<< "Difference to nearest warehouse policy on the same scenarios: " << differenceEstimate.mean << " +- " << differenceEstimate.halfWidth() << " (baseline costs: " << baselineEstimate.mean << ")" <<std::endl;
+    }
+    if (targetHalfWidth > 0){
+        std::cout<< "Replications saved: " << maxEpochs - costEstimate.count << " of " << maxEpochs <<std::endl;
+    }
+    if (repositioning.isActive()){
+        std::cout<< repositioning.describe() <<std::endl;
+    }
+    if (decisionCache && decisionCacheStatistics.nbHits + decisionCacheStatistics.nbMisses > 0){
+        std::cout<< decisionCacheStatistics.describe() << " Entries: " << decisionCache->size() << " of " << decisionCache->getCapacity() << " Evicted: " << decisionCache->getNbEvictions() <<std::endl;
+    }
+}
+
+std::vector<int> Environment::getWaitingTimeQuantiles(){
+    return {waitingTimes.quantile(0.5), waitingTimes.quantile(0.9), waitingTimes.quantile(0.95), waitingTimes.quantile(0.99)};
+}
+
+void Environment::mergeEpisodeKpis(WaitingTimeHistogram& allWaitingTimes, std::vector<WarehouseStatistics>& allWarehouseStatistics){
+    allWaitingTimes.merge(waitingTimes);
+    allWarehouseStatistics.resize(warehouseStatistics.size());
+    for (size_t w = 0; w < warehouseStatistics.size(); w++){
+        allWarehouseStatistics[w].merge(warehouseStatistics[w]);
+    }
 }
 
 
@@ -394,14 +830,27 @@ void Environment::updateOrderBeingServedNext(){
     }
 }
 
+uint64_t Environment::getServiceZones(Order* order)
+{
+    if (data->clientZones.empty()) return ~(uint64_t)0;
+    return data->clientZones[order->client->clientID];
+}
+
 void Environment::chooseClosestWarehouseForOrder(Order* newOrder)
 {
-    // For now we just assign the order to the closest warehouse
-    int indexClosestWarehouse;
-    std::vector<int> distancesToWarehouses = data->travelTime.getRow(newOrder->client->clientID);
-    indexClosestWarehouse = std::min_element(distancesToWarehouses.begin(), distancesToWarehouses.end())-distancesToWarehouses.begin();
+    // For now we just assign the order to the closest warehouse (among the ones whose service zone contains the client)
+    const int* distancesToWarehouses = data->travelTime.getRowData(newOrder->client->clientID, currentTime);
+    uint64_t zones = getServiceZones(newOrder);
+    int indexClosestWarehouse = -1;
+    if (data->clientZones.empty()){
+        indexClosestWarehouse = std::min_element(distancesToWarehouses, distancesToWarehouses + data->nbWarehouses) - distancesToWarehouses;
+    }else{
+        for (int w = 0; w < data->nbWarehouses; w++){
+            if ((zones >> w & 1) && (indexClosestWarehouse < 0 || distancesToWarehouses[w] < distancesToWarehouses[indexClosestWarehouse])) indexClosestWarehouse = w;
+        }
+    }
     
-    if (warehouses[indexClosestWarehouse]->couriersAssigned.size() > 0 && getNumberOfAvailablePickers(warehouses[indexClosestWarehouse]) > 0){
+    if (indexClosestWarehouse >= 0 && warehouses[indexClosestWarehouse]->couriersAssigned.size() > 0 && getNumberOfAvailablePickers(warehouses[indexClosestWarehouse]) > 0){
         newOrder->assignedWarehouse = warehouses[indexClosestWarehouse];
         newOrder->accepted = true;
     }else{
@@ -411,44 +860,192 @@ void Environment::chooseClosestWarehouseForOrder(Order* newOrder)
 }
 
 torch::Tensor Environment::getStateAssignmentProblem(Order* order){
-    // For now, the state is only the distances to the warehouses
-    std::vector<int> distancesToWarehouses = data->travelTime.getRow(order->client->clientID);
-    std::vector<float> state;
-    for (int i = 0; i < distancesToWarehouses.size(); i++) {
-        state.push_back(distancesToWarehouses[i]);
+    torch::Tensor state = (this->*stateKernel)(order);
+    if (nbPolicyWarehouses == data->nbWarehouses){
+        return state;
     }
-    
-    std::vector<int> wareHouseLoad;
-    for (Warehouse* w : warehouses){
-        state.push_back(w->couriersAssigned.size());
-        state.push_back(getNumberOfAvailablePickers(w));
-        state.push_back(std::max(0, getFastestAvailablePicker(w)->timeWhenAvailable - currentTime));
-        state.push_back(std::max(0, getFastestAvailableCourier(w)->timeWhenAvailable - currentTime));
+    torch::Tensor paddedState = torch::zeros({1, nbPolicyWarehouses*5}, torch::TensorOptions().dtype(at::kFloat));
+    paddedState.narrow(1, 0, data->nbWarehouses).copy_(state.narrow(1, 0, data->nbWarehouses));
+    paddedState.narrow(1, nbPolicyWarehouses, 4*data->nbWarehouses).copy_(state.narrow(1, data->nbWarehouses, 4*data->nbWarehouses));
+    return paddedState;
+}
+
+template <int N>
+torch::Tensor Environment::buildStateAssignmentProblem(Order* order){
+    typedef WarehouseKernels<N> Kernels;
+    const int nbWarehouses = Kernels::count(data->nbWarehouses);
+    typename Kernels::State state = Kernels::makeState(nbWarehouses);
+
+    // For now, the state is the distances to the warehouses, followed by the load of each warehouse
+    const int* distancesToWarehouses = data->travelTime.getRowData(order->client->clientID, currentTime);
+    for (int w = 0; w < nbWarehouses; w++) {
+        state[w] = distancesToWarehouses[w];
+    }
+    for (int w = 0; w < nbWarehouses; w++){
+        Warehouse* warehouse = warehouses[w];
+        state[nbWarehouses + 4*w] = warehouse->couriersAssigned.size();
+        state[nbWarehouses + 4*w + 1] = getNumberOfAvailablePickers(warehouse);
+        state[nbWarehouses + 4*w + 2] = std::max(0, getFastestAvailablePicker(warehouse)->timeWhenAvailable - currentTime);
+        state[nbWarehouses + 4*w + 3] = std::max(0, getFastestAvailableCourier(warehouse)->timeWhenAvailable - currentTime);
     }
 
     //state.push_back(currentTime);
 
-    // vector to tensor
+    // array to tensor
     auto options = torch::TensorOptions().dtype(at::kFloat);
-    torch::Tensor stateTensor = torch::from_blob(state.data(), {1, data->nbWarehouses*5}, options).clone().to(torch::kFloat);
+    torch::Tensor stateTensor = torch::from_blob(state.data(), {1, nbWarehouses*5}, options).clone();
     return stateTensor;
 }
 
 
 
+SimulationState Environment::snapshot()
+{
+    // Couriers, pickers and orders are referred to by their index: couriers by their ID, pickers by their position at the warehouse
+    SimulationState state(data);
+    state.setTime(currentTime);
+    for (Courier* courier : couriers){
+        state.courier(courier->courierID) = StateCourier{courier->timeWhenAvailable, -1, courier->assignedToWarehouse->wareID};
+    }
+    for (Warehouse* warehouse : warehouses){
+        WarehouseState& warehouseState = state.mutableWarehouse(warehouse->wareID);
+        warehouseState.couriers.clear();
+        for (Courier* courier : warehouse->couriersAssigned){
+            warehouseState.couriers.push_back(courier->courierID);
+        }
+        warehouseState.pickerTimes.clear();
+        for (Picker* picker : warehouse->pickersAssigned){
+            warehouseState.pickerTimes.push_back(picker->timeWhenAvailable);
+        }
+    }
+    auto stateOrder = [](Order* order){
+        Warehouse* warehouse = order->assignedWarehouse;
+        int picker = std::find(warehouse->pickersAssigned.begin(), warehouse->pickersAssigned.end(), order->assignedPicker) - warehouse->pickersAssigned.begin();
+        int courier = order->assignedCourier ? order->assignedCourier->courierID : -1;
+        return StateOrder{order->client->clientID, warehouse->wareID, order->orderTime, order->timeToComission, order->serviceTimeAtClient, picker, order->arrivalTime, courier};
+    };
+    // Only orders that are in the system are needed: the ones on the way to their client and the ones waiting for a courier
+    for (Order* order : ordersAssignedToCourierButNotServed){
+        state.courier(order->assignedCourier->courierID).order = state.addOrder(stateOrder(order));
+    }
+    for (Warehouse* warehouse : warehouses){
+        for (Order* order : warehouse->ordersNotAssignedToCourier){
+            state.mutableWarehouse(warehouse->wareID).queue.push_back(state.addOrder(stateOrder(order)));
+        }
+    }
+    return state;
+}
+
+void Environment::chooseWarehouseForOrderRollout(Order* newOrder, int timeLimit)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    // The candidates are the nearest warehouses (whether or not they have couriers, the order may wait for one) and rejecting the order (-1)
+    const int* distancesToWarehouses = data->travelTime.getRowData(newOrder->client->clientID, currentTime);
+    uint64_t zones = getServiceZones(newOrder);
+    std::vector<int> candidates;
+    for (int w = 0; w < data->nbWarehouses; w++){
+        if (zones >> w & 1) candidates.push_back(w);
+    }
+    int nbNearest = std::min(nbRolloutCandidates, (int)candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + nbNearest, candidates.end(), [&](int a, int b){ return distancesToWarehouses[a] < distancesToWarehouses[b]; });
+    candidates.resize(nbNearest);
+    candidates.push_back(-1);
+    int nbCandidates = candidates.size();
+
+    // Every candidate starts from a copy of the same snapshot, and scenario s draws the same arrivals for every candidate (common random numbers).
+    // The threads take the candidates round-robin and stop after the scenario in which the time budget runs out
+    const SimulationState root = snapshot();
+    std::vector<std::vector<long long>> rolloutCosts(nbCandidates);
+    // The pool is started with the first decision, i.e., after a replication worker was forked, and sized from the simulation CPUs of the process
+    if (!rolloutPool){
+        int nbSimulationThreads = ThreadManager::global().getNbSimulationThreads();
+        int poolSize = nbRolloutThreads > 0 ? std::min(nbRolloutThreads, nbSimulationThreads) : nbSimulationThreads;
+        rolloutPool.reset(new ThreadPool(poolSize, [](int t){ ThreadManager::global().pinSimulationThread(t); }));
+    }
+    int nbThreads = std::max(1, std::min(rolloutPool->size(), nbCandidates));
+    unsigned decisionSeed = rolloutSeed * 1000003u + (unsigned)newOrder->orderID * 7919u;
+    auto evaluateCandidates = [&](int thread){
+        for (int s = 0; s < maxRolloutScenarios; s++){
+            for (int c = thread; c < nbCandidates; c += nbThreads){
+                SimulationState state = root.snapshot();
+                state.addArrival(newOrder->client->clientID, newOrder->timeToComission, newOrder->serviceTimeAtClient, candidates[c]);
+                XorShift128 rng((int)(decisionSeed + (unsigned)s * 104729u));
+                for (int warmUp = 0; warmUp < 16; warmUp++){
+                    rng();
+                }
+                state.rollout(rolloutHorizon, timeLimit, rng);
+                rolloutCosts[c].push_back(state.getCosts());
+            }
+            if (rolloutTimeBudget > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() >= rolloutTimeBudget){
+                break;
+            }
+        }
+    };
+    rolloutPool->run(evaluateCandidates, nbThreads);
+
+    // Candidates are compared on the scenarios that all of them completed. On ties, the nearer warehouse is preferred and rejecting comes last
+    size_t nbScenarios = rolloutCosts[0].size();
+    for (const std::vector<long long>& costs : rolloutCosts){
+        nbScenarios = std::min(nbScenarios, costs.size());
+    }
+    int best = 0;
+    long long bestCosts = LLONG_MAX;
+    for (int c = 0; c < nbCandidates; c++){
+        long long totalCosts = 0;
+        for (size_t s = 0; s < nbScenarios; s++){
+            totalCosts += rolloutCosts[c][s];
+        }
+        if (totalCosts < bestCosts){
+            bestCosts = totalCosts;
+            best = c;
+        }
+    }
+    if (candidates[best] < 0){
+        newOrder->accepted = false;
+        rejectCount++;
+    }else{
+        newOrder->assignedWarehouse = warehouses[candidates[best]];
+        newOrder->accepted = true;
+    }
+
+    double decisionTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    nbRolloutDecisions++;
+    nbRolloutScenarios += nbScenarios;
+    totalRolloutTime += decisionTime;
+    maxRolloutTime = std::max(maxRolloutTime, decisionTime);
+}
+
 void Environment::chooseWarehouseForOrderREINFORCE(Order* newOrder, policyNetwork& n, bool train)
 {
-    torch::Tensor state = getStateAssignmentProblem(newOrder);
-    torch::Tensor prediction = n.forward(state);
-    // Prediction tensor to vector
-    std::vector<float> predVector(prediction.data_ptr<float>(), prediction.data_ptr<float>() + prediction.numel());
+    // An order outside of all service zones is rejected without inference. Nothing is sampled, so in training it is not part of the trajectory
+    uint64_t zones = getServiceZones(newOrder);
+    if (zones == 0){
+        newOrder->accepted = false;
+        rejectCount++;
+        return;
+    }
+    torch::Tensor state;
     int indexWarehouse;
-    if (train){
-        std::discrete_distribution<> discrete_dist(predVector.begin(), predVector.end());
-        // Choose based on the distribution
-        indexWarehouse = discrete_dist(data->rng);
+    if (decisionCache && !train){
+        // In evaluation, the action of a state that was seen before (up to the rounding of the waiting times) is taken from the cache
+        auto startTime = std::chrono::steady_clock::now();
+        fillDecisionKey(newOrder);
+        if (decisionCache->find(decisionKey, indexWarehouse)){
+            decisionCacheStatistics.nbHits++;
+            decisionCacheStatistics.hitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            if (decisionCacheVerify > 0 && decisionCacheStatistics.nbHits % decisionCacheVerify == 0){
+                decisionCacheStatistics.nbVerified++;
+                if (getActionREINFORCE(getStateAssignmentProblem(newOrder), n, zones, false) != indexWarehouse) decisionCacheStatistics.nbMismatches++;
+            }
+        }else{
+            indexWarehouse = getActionREINFORCE(getStateAssignmentProblem(newOrder), n, zones, false);
+            decisionCache->insert(decisionKey, indexWarehouse);
+            decisionCacheStatistics.nbMisses++;
+            decisionCacheStatistics.missTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        }
     }else{
-        indexWarehouse = std::max_element(predVector.begin(), predVector.end())-predVector.begin();
+        state = getStateAssignmentProblem(newOrder);
+        indexWarehouse = getActionREINFORCE(state, n, zones, train);
     }
 
     // If the index is nb.warehouses, we reject the order
@@ -461,13 +1058,77 @@ void Environment::chooseWarehouseForOrderREINFORCE(Order* newOrder, policyNetwor
     }
 
     if (train){
-        if (newOrder->orderID == 0){
+        // Rejecting is the last output of the (possibly padded) net
+        int action = indexWarehouse >= data->nbWarehouses ? nbPolicyWarehouses : indexWarehouse;
+        torch::Tensor mask = getActionMask(zones);
+        if (!assingmentProblemStates.defined()){
             assingmentProblemStates = state;
-            assingmentProblemActions = torch::tensor({indexWarehouse});
+            assingmentProblemActions = torch::tensor({action});
+            assignmentProblemMasks = mask;
         }else{
             assingmentProblemStates = torch::cat({assingmentProblemStates, state});
-            assingmentProblemActions = torch::cat({assingmentProblemActions, torch::tensor({indexWarehouse})});
+            assingmentProblemActions = torch::cat({assingmentProblemActions, torch::tensor({action})});
+            assignmentProblemMasks = torch::cat({assignmentProblemMasks, mask});
         }
+        assignmentProblemOrders.push_back(newOrder->orderID);
+    }
+}
+
+int Environment::getActionREINFORCE(torch::Tensor state, policyNetwork& n, uint64_t zones, bool train)
+{
+    torch::Tensor prediction = n.forward(state).contiguous();
+    // The action is taken directly from the output buffer: sampled from the distribution in training, the most likely one otherwise.
+    // Warehouses outside of the service zone get weight 0 in a copy of the output. A padded net has outputs for warehouses the instance
+    // does not have, the copy leaves them out and puts the reject output right after the real warehouses
+    const float* weights = prediction.data_ptr<float>();
+    std::vector<float> zoneWeights;
+    if (!data->clientZones.empty() || nbPolicyWarehouses != data->nbWarehouses){
+        zoneWeights.assign(weights, weights + data->nbWarehouses);
+        zoneWeights.push_back(weights[nbPolicyWarehouses]);
+        for (int w = 0; w < data->nbWarehouses && !data->clientZones.empty(); w++){
+            if (!(zones >> w & 1)) zoneWeights[w] = 0.0f;
+        }
+        weights = zoneWeights.data();
+    }
+    if (train){
+        return sampleFromRow(weights, data->nbWarehouses + 1, drawUniform(rng));
+    }
+    int action;
+    argmaxRows(weights, 1, data->nbWarehouses + 1, &action);
+    return action;
+}
+
+torch::Tensor Environment::getActionMask(uint64_t zones)
+{
+    torch::Tensor mask = torch::zeros({1, nbPolicyWarehouses + 1}, torch::TensorOptions().dtype(at::kFloat));
+    float* allowed = mask.data_ptr<float>();
+    for (int w = 0; w < data->nbWarehouses; w++){
+        allowed[w] = (data->clientZones.empty() || (zones >> w & 1)) ? 1.0f : 0.0f;
+    }
+    allowed[nbPolicyWarehouses] = 1.0f;
+    return mask;
+}
+
+torch::Tensor Environment::getMaskedProbabilities(torch::Tensor predictions, torch::Tensor actions, torch::Tensor masks)
+{
+    torch::Tensor maskedPredictions = predictions * masks;
+    auto rows = torch::arange(0, predictions.size(0), torch::kLong);
+    return maskedPredictions.index({rows, actions}) / maskedPredictions.sum(1);
+}
+
+void Environment::fillDecisionKey(Order* order){
+    // The zones of an order only depend on its client, so they are part of the key as well
+    decisionKey.clear();
+    decisionKey.push_back(order->client->clientID);
+    decisionKey.push_back(std::max(currentTime, 0) / data->travelTime.slotLength() % data->travelTime.nbSlots());
+    for (int w = 0; w < data->nbWarehouses; w++){
+        Warehouse* warehouse = warehouses[w];
+        int pickerWait = std::max(0, getFastestAvailablePicker(warehouse)->timeWhenAvailable - currentTime);
+        int courierWait = std::max(0, getFastestAvailableCourier(warehouse)->timeWhenAvailable - currentTime);
+        decisionKey.push_back(warehouse->couriersAssigned.size());
+        decisionKey.push_back(getNumberOfAvailablePickers(warehouse));
+        decisionKey.push_back((pickerWait + decisionCacheQuantum - 1) / decisionCacheQuantum);
+        decisionKey.push_back((courierWait + decisionCacheQuantum - 1) / decisionCacheQuantum);
     }
 }
 
@@ -475,8 +1136,14 @@ torch::Tensor Environment::getCostsVectorDiscountedAssignmentProblem(float lambd
     std::vector<float> costsVec;
     int orderCounter = 0;
     double costsForOrder;
+    // Only the recorded decisions get costs: orders outside of all service zones were rejected without one
+    size_t nextDecision = 0;
     for (Order* order: orders){
         orderCounter ++;
+        if (nextDecision == assignmentProblemOrders.size() || assignmentProblemOrders[nextDecision] != order->orderID){
+            continue;
+        }
+        nextDecision++;
         if (order->accepted){
             if (order->arrivalTime != -1){
                 costsForOrder = order->arrivalTime-order->orderTime;  
@@ -504,101 +1171,287 @@ torch::Tensor Environment::getCostsVectorDiscountedAssignmentProblem(float lambd
 
     // vector to tensor
     auto options = torch::TensorOptions().dtype(at::kFloat);
-    torch::Tensor costs = torch::from_blob(costsVec.data(), {1, orderCounter}, options).clone().to(torch::kFloat);
+    torch::Tensor costs = torch::from_blob(costsVec.data(), {1, (int64_t)costsVec.size()}, options).clone().to(torch::kFloat);
     return costs;
 }
 
+torch::Tensor Environment::getCostsVectorDiscountedRepositioningProblem(float lambdaTemporal, float lambdaSpatial){
+    // The orders are stored in the order of their arrival, so the orders after a decision start at the first one that arrives at or after it
+    int nbDecisions = repositioningActions.size();
+    std::vector<float> costsVec(nbDecisions, 0.0f);
+    for (int d = 0; d < nbDecisions; d++){
+        Warehouse* warehouse = warehouses[repositioningWarehouses[d]];
+        auto first = std::lower_bound(orders.begin(), orders.end(), repositioningTimes[d], [](Order* order, int time){ return order->orderTime < time; });
+        double costsForDecision = 0.0;
+        for (auto orderAfter = first; orderAfter != orders.end(); ++orderAfter){
+            double dist;
+            double costsForOrder;
+            if ((*orderAfter)->arrivalTime != -1){
+                dist = euclideanDistance((*orderAfter)->assignedWarehouse->lat, warehouse->lat, (*orderAfter)->assignedWarehouse->lon, warehouse->lon);
+                costsForOrder = (*orderAfter)->arrivalTime - (*orderAfter)->orderTime;
+            }else{
+                dist = euclideanDistance((*orderAfter)->client->lat, warehouse->lat, (*orderAfter)->client->lon, warehouse->lon);
+                costsForOrder = data->penaltyForNotServing;
+            }
+            costsForDecision += costsForOrder * pow(lambdaTemporal, (*orderAfter)->orderTime - repositioningTimes[d]) * pow(lambdaSpatial, dist);
+        }
+        costsVec[d] = costsForDecision;
+    }
+    auto options = torch::TensorOptions().dtype(at::kFloat);
+    return torch::from_blob(costsVec.data(), {1, nbDecisions}, options).clone();
+}
+
 double Environment::euclideanDistance(double latFrom, double latTo, double lonFrom, double lonTo){
     double dx = latFrom - latTo;
     double dy = lonFrom - lonTo;
     return std::sqrt(dx * dx + dy * dy)*100;
 }
 
-void Environment::trainREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial)
+void Environment::dispatchOrder(Order* newOrder)
 {
-    std::cout<<"----- Training REINFORCE starts with lambda temporal " << lambdaTemporal << " and lambda spatial " << lambdaSpatial << " -----"<<std::endl;
+    logEvent(ORDER_ASSIGNED, newOrder->orderID, newOrder->accepted ? newOrder->assignedWarehouse->wareID : -1, -1, 0);
+    if (!newOrder->accepted){
+        objValueOfFinishedOrders += data->penaltyForNotServing;
+        // In streaming mode, a rejected order is finished and not needed anymore
+        if (episodeStorage == STORE_STATISTICS){
+            delete newOrder;
+        }
+        return;
+    }
+    nbOrdersAccepted++;
+    warehouseStatistics[newOrder->assignedWarehouse->wareID].nbOrdersAccepted++;
+    choosePickerForOrder(newOrder);
+    // If there are couriers assigned to the warehouse, we can assign a courier to the order
+    if (newOrder->assignedWarehouse->couriersAssigned.size()>0){
+        chooseCourierForOrder(newOrder);
+        AddOrderToVector(ordersAssignedToCourierButNotServed, newOrder);
+    }else{ // else we add the order to list of orders that have not been assigned to a courier yet
+        newOrder->backlogHandle = newOrder->assignedWarehouse->ordersNotAssignedToCourier.push(newOrder);
+        warehouseStatistics[newOrder->assignedWarehouse->wareID].observeQueueLength(currentTime, newOrder->assignedWarehouse->ordersNotAssignedToCourier.size());
+    }
+}
+
+void Environment::simulateEpisode(int timeLimit, const std::function<void(Order*)>& chooseWarehouseForOrder, int batchWindow)
+{
+    int counter = 0;
+    currentTime = 0;
+    timeCustomerArrives = 0;
+    timeNextCourierArrivesAtOrder = INT_MAX;
+    ordersInBatch = std::vector<Order*>(0);
+    logEvent(EPISODE_START, episodeCounter, -1, -1, 0);
+    while (currentTime < timeLimit || ordersAssignedToCourierButNotServed.size() > 0 || ordersInBatch.size() > 0){
+        ensureArrivalsDrawn(timeLimit, counter);
+        // In batch mode, the window closes before the next arrival or courier event that happens after it
+        if (ordersInBatch.size() > 0){
+            int timeNextOrderArrives = (counter < getNbArrivalsDrawn()-1 && timeCustomerArrives <= timeLimit) ? timeCustomerArrives + orderTimes[counter - arrivalOffset] : INT_MAX;
+            if (batchWindowEnd <= std::min(timeNextOrderArrives, timeNextCourierArrivesAtOrder)){
+                currentTime = batchWindowEnd;
+                if (measureDecisionLatency && observeEpisode){
+                    auto decisionStart = std::chrono::steady_clock::now();
+                    assignBatch();
+                    addDecisionLatency(std::chrono::duration<double>(std::chrono::steady_clock::now() - decisionStart).count());
+                }else{
+                    assignBatch();
+                }
+                continue;
+            }
+        }
+        // Keep track of current time
+        if (counter == getNbArrivalsDrawn()-1){
+            currentTime = timeNextCourierArrivesAtOrder;
+        }else{
+            currentTime = std::min(timeCustomerArrives, timeNextCourierArrivesAtOrder);
+        }
+        if (timeCustomerArrives < timeNextCourierArrivesAtOrder && currentTime <= timeLimit && counter<getNbArrivalsDrawn()-1){
+            timeCustomerArrives += orderTimes[counter - arrivalOffset];
+            currentTime = timeCustomerArrives;
+            counter += 1;
+            // Draw new order and assign it to warehouse, picker and courier. MUST BE IN THAT ORDER!!!
+            Order* newOrder = new Order;
+            initOrder(timeCustomerArrives, newOrder);
+            // In streaming mode, only orders that are in the system are kept
+            if (episodeStorage != STORE_STATISTICS){
+                orders.push_back(newOrder);
+            }
+            logEvent(ORDER_ARRIVAL, newOrder->orderID, -1, -1, newOrder->client->clientID);
+            if (batchWindow > 0){
+                // In batch mode, the order waits until the window closes and is then assigned jointly with the other orders of the window
+                if (ordersInBatch.empty()){
+                    batchWindowEnd = timeCustomerArrives + batchWindow;
+                }
+                ordersInBatch.push_back(newOrder);
+            }else{
+                // We immediately assign the order to a warehouse (with the policy that is applied) and a picker
+                if (measureDecisionLatency && observeEpisode){
+                    auto decisionStart = std::chrono::steady_clock::now();
+                    chooseWarehouseForOrder(newOrder);
+                    addDecisionLatency(std::chrono::duration<double>(std::chrono::steady_clock::now() - decisionStart).count());
+                }else{
+                    chooseWarehouseForOrder(newOrder);
+                }
+                dispatchOrder(newOrder);
+            }
+        }else { // when a courier arrives at an order
+            if (nextOrderBeingServed){
+                Courier* c = nextOrderBeingServed->assignedCourier;
+                // We choose a warehouse for the courier
+                chooseClosestWarehouseForCourier(c);
+                // If the chosen warehouse has order that have not been assigned to a courier yet, we can now assign the order to a courier
+                if (!c->assignedToWarehouse->ordersNotAssignedToCourier.empty()){
+                    Order* orderToAssignToCourier = c->assignedToWarehouse->ordersNotAssignedToCourier.front();
+                    chooseCourierForOrder(orderToAssignToCourier);
+                    AddOrderToVector(ordersAssignedToCourierButNotServed, orderToAssignToCourier);
+                }
+            }
+        }
+    }
+    // The warehouses are observed until the last courier is back
+    int endTime = std::max(currentTime, latestArrivalTime);
+    for (Warehouse* warehouse : warehouses){
+        warehouseStatistics[warehouse->wareID].finishEpisode(endTime, warehouse->initialNbPickers);
+    }
+    for (Courier* courier : couriers){
+        warehouseStatistics[courier->assignedToWarehouse->wareID].addCourierTime(courier->assignedSince, endTime);
+    }
+    if (observeEpisode){
+        updateEpisodeMetrics();
+    }
+}
+
+void Environment::addDecisionLatency(double seconds)
+{
+    decisionLatencyCounts[decisionLatencyMetric->bucketOf(seconds)]++;
+    decisionLatencySum += seconds;
+}
+
+void Environment::updateEpisodeMetrics()
+{
+    // The counters of the episode are added at once, so the simulation does not touch shared cache lines per event
+    episodesMetric->add();
+    eventsMetric->add(nbOrdersArrived + nbOrdersServed);
+    ordersMetric->add(nbOrdersArrived);
+    rejectedOrdersMetric->add(rejectCount);
+    episodeCostsMetric->set(getObjValue());
+    rejectionRateMetric->set(nbOrdersArrived > 0 ? (double)rejectCount / nbOrdersArrived : 0.0);
+    size_t maxBacklog = 0;
+    for (Warehouse* warehouse : warehouses){
+        maxBacklog = std::max(maxBacklog, warehouse->ordersNotAssignedToCourier.highWaterMark());
+    }
+    maxBacklogMetric->set(maxBacklog);
+    if (measureDecisionLatency){
+        decisionLatencyMetric->merge(decisionLatencyCounts, decisionLatencySum);
+        std::fill(decisionLatencyCounts.begin(), decisionLatencyCounts.end(), 0);
+        decisionLatencySum = 0.0;
+    }
+}
+
+void Environment::trainREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial, std::string netFileName)
+{
+    runREINFORCE(timeLimit, lambdaTemporal, lambdaSpatial, data->getOption("reinforceBaseline", "none"), 8000, 0.0, netFileName, true);
+}
+
+int Environment::runREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial, const std::string& baseline, int nbEpochs, double targetCosts, std::string netFileName, bool writeResults)
+{
+    if (baseline != "none" && baseline != "running" && baseline != "critic"){
+        throw std::invalid_argument("Unknown REINFORCE baseline: " + baseline);
+    }
+    // Training needs the orders of the whole episode for the discounted costs, but not the routes. Later episodes keep what was requested
+    EpisodeStorage requestedStorage = storage;
+    storage = STORE_ORDERS;
+    std::cout<<"----- Training REINFORCE starts with lambda temporal " << lambdaTemporal << " and lambda spatial " << lambdaSpatial << " and baseline " << baseline << (mixedPrecision ? " in bf16 mixed precision" : "") << " -----"<<std::endl;
+    trainingUpdateTime = 0.0;
+    trainingAverageCosts = 0.0;
+    // With --trainInstances, the episodes are simulated on instances drawn from the pool, each for --episodesPerInstance episodes in a row
+    Data* primaryData = data;
+    if (data->hasOption("trainInstances") && trainingInstances.empty()){
+        loadTrainingInstances();
+    }
+    int episodesPerInstance = std::max(1, (int)data->getOption("episodesPerInstance", 1.0));
     // Create neural network where each output node is assigned to a warehouse and one extra node for the reject decision
-    auto assignmentNet = std::make_shared<policyNetwork>(data->nbWarehouses*5, data->nbWarehouses+1);
+    auto assignmentNet = std::make_shared<policyNetwork>(nbPolicyWarehouses*5, nbPolicyWarehouses+1);
     torch::Tensor lossAssignmentNet;
+    // The critic estimates the discounted costs of a state, the running baseline keeps an average of the discounted costs per nearest warehouse
+    auto critic = std::make_shared<valueNetwork>(nbPolicyWarehouses*5);
+    torch::optim::Adam optimizerCritic(critic->parameters(), /*lr=*/0.001);
+    std::vector<double> runningBaselines;
     
 
     // Create an instance of the custom loss function
     logLoss loss_fn;
     // Instantiate an Adam optimization algorithm to update our Nets' parameters.
     torch::optim::Adam optimizerAssignmentNet(assignmentNet->parameters(), /*lr=*/0.0002);
+    // A learned repositioning policy is trained on the same episodes, its decisions are sampled from the net that is being trained
+    std::shared_ptr<repositioningNetwork> repositioningNet;
+    std::unique_ptr<torch::optim::Adam> optimizerRepositioningNet;
+    if (repositioning.getPolicy() == "net"){
+        repositioningNet = std::make_shared<repositioningNetwork>(CourierRepositioning::nbFeatures, CourierRepositioning::nbHidden);
+        optimizerRepositioningNet.reset(new torch::optim::Adam(repositioningNet->parameters(), /*lr=*/0.001));
+        repositioning.setNet(*repositioningNet);
+        trainRepositioning = true;
+    }
     double running_costs = 0.0;
     double runningCounter = 0.0;
     double runningRejectedpercentage = 0.0;
     std::vector< float> averageCostVector;
     std::vector< float> averageRejectionRateVector;
-    for (int epoch = 1; epoch <= 8000; epoch++) {
+    int epochsToTarget = -1;
+    for (int epoch = 1; epoch <= nbEpochs; epoch++) {
+        if (!trainingInstances.empty() && (epoch - 1) % episodesPerInstance == 0){
+            size_t instance = std::min(trainingInstances.size() - 1, (size_t)(drawUniform(rng) * trainingInstances.size()));
+            useInstance(trainingInstances[instance].get());
+        }
         // Initialize data structures
         initialize(timeLimit);
         // Start with simulation
-        int counter = 0;
-        currentTime = 0;
-        timeCustomerArrives = 0;
-        timeNextCourierArrivesAtOrder = INT_MAX;
-        while (currentTime < timeLimit || ordersAssignedToCourierButNotServed.size() > 0){
-            // Keep track of current time
-            if (counter == orderTimes.size()-1){
-                currentTime = timeNextCourierArrivesAtOrder;
-            }else{
-                currentTime = std::min(timeCustomerArrives, timeNextCourierArrivesAtOrder);
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderREINFORCE(newOrder, *assignmentNet, true); });
+        // Reset gradients of neural network.
+        //optimizerAssignmentNet.zero_grad();
+        // An episode in which every order was outside of all service zones has no decision to learn from
+        if (assingmentProblemActions.defined()){
+            torch::Tensor assignmentCosts = getCostsVectorDiscountedAssignmentProblem(lambdaTemporal, lambdaSpatial);
+            if (baseline != "none"){
+                assignmentCosts = getAdvantages(assignmentCosts, baseline, *critic, optimizerCritic, runningBaselines);
             }
-            if (timeCustomerArrives < timeNextCourierArrivesAtOrder && currentTime <= timeLimit && counter<orderTimes.size()-1){
-                timeCustomerArrives += orderTimes[counter];
-                currentTime = timeCustomerArrives;
-                counter += 1;
-                // Draw new order and assign it to warehouse, picker and courier. MUST BE IN THAT ORDER!!!
-                Order* newOrder = new Order;
-                initOrder(timeCustomerArrives, newOrder);
-                orders.push_back(newOrder);
-                // We immediately assign the order to a warehouse and a picker
-                chooseWarehouseForOrderREINFORCE(newOrder, *assignmentNet, true);
-                if (newOrder->accepted){
-                    choosePickerForOrder(newOrder);
-                    // If there are couriers assigned to the warehouse, we can assign a courier to the order
-                    if (newOrder->assignedWarehouse->couriersAssigned.size()>0){
-                        chooseCourierForOrder(newOrder);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, newOrder);
-                    }else{ // else we add the order to list of orders that have not been assigned to a courier yet
-                        newOrder->assignedWarehouse->ordersNotAssignedToCourier.push_back(newOrder);  
-                    }
-                }
-
-            }else { // when a courier arrives at an order
-                if (nextOrderBeingServed){
-                    Courier* c = nextOrderBeingServed->assignedCourier;
-                    // We choose a warehouse for the courier
-                    chooseClosestWarehouseForCourier(c);
-                    // If the chosen warehouse has order that have not been assigned to a courier yet, we can now assign the order to a courier
-                    if (c->assignedToWarehouse->ordersNotAssignedToCourier.size()>0){
-                        Order* orderToAssignToCourier = c->assignedToWarehouse->ordersNotAssignedToCourier[0];
-                        chooseCourierForOrder(orderToAssignToCourier);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, orderToAssignToCourier);
-                    }
-                }
+            auto updateStart = std::chrono::steady_clock::now();
+            torch::Tensor predAsssignment = assignmentNet->forward(assingmentProblemStates, mixedPrecision);
+            auto resultAssignment = getMaskedProbabilities(predAsssignment, assingmentProblemActions, assignmentProblemMasks);
+            lossAssignmentNet = loss_fn.forward(resultAssignment, assignmentCosts);
+            lossAssignmentNet.backward();
+            optimizerAssignmentNet.step();       // Update the parameters based on the calculated gradients.
+            trainingUpdateTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - updateStart).count();
+            lossMetric->set(lossAssignmentNet.item<float>());
+        }
+        if (repositioningNet && !repositioningActions.empty()){
+            int nbDecisions = repositioningActions.size();
+            torch::Tensor repositioningCosts = getCostsVectorDiscountedRepositioningProblem(lambdaTemporal, lambdaSpatial);
+            if (nbDecisions > 1){
+                repositioningCosts = (repositioningCosts - repositioningCosts.mean()) / (repositioningCosts.std() + 1e-8);
             }
+            int nbCandidates = repositioningStates.size() / (nbDecisions * CourierRepositioning::nbFeatures);
+            torch::Tensor states = torch::from_blob(repositioningStates.data(), {nbDecisions, nbCandidates, CourierRepositioning::nbFeatures}, torch::TensorOptions().dtype(at::kFloat)).clone();
+            torch::Tensor actions = torch::from_blob(repositioningActions.data(), {nbDecisions}, torch::TensorOptions().dtype(at::kLong)).clone();
+            torch::Tensor predRepositioning = repositioningNet->forward(states);
+            torch::Tensor resultRepositioning = predRepositioning.index({torch::arange(0, nbDecisions, torch::kLong), actions});
+            optimizerRepositioningNet->zero_grad();
+            loss_fn.forward(resultRepositioning, repositioningCosts).backward();
+            optimizerRepositioningNet->step();
+            repositioning.setNet(*repositioningNet);
         }
-        // Reset gradients of neural network.
-        //optimizerAssignmentNet.zero_grad();
-        torch::Tensor assignmentCosts = getCostsVectorDiscountedAssignmentProblem(lambdaTemporal, lambdaSpatial);
-        torch::Tensor predAsssignment = assignmentNet->forward(assingmentProblemStates);
-        auto rowsAssignment = torch::arange(0, predAsssignment.size(0), torch::kLong);
-        auto resultAssignment = predAsssignment.index({rowsAssignment, assingmentProblemActions});
-        lossAssignmentNet = loss_fn.forward(resultAssignment, assignmentCosts);
-        lossAssignmentNet.backward();
-        optimizerAssignmentNet.step();       // Update the parameters based on the calculated gradients.
         
         running_costs += getObjValue();
-        runningRejectedpercentage += (float)rejectCount/(float)orderTimes.size();
+        runningRejectedpercentage += (float)rejectCount/(float)getNbArrivalsDrawn();
         runningCounter += 1;
+        averageCostsMetric->set(running_costs / runningCounter);
        
         if (epoch % 100 == 0) {
             std::cout << "[Iteration: " << epoch << "] Average costs: " << running_costs / runningCounter << " Rejected requests:" << runningRejectedpercentage / runningCounter << std::endl;
             averageCostVector.push_back(running_costs/runningCounter);
             averageRejectionRateVector.push_back(runningRejectedpercentage / runningCounter);
+            trainingAverageCosts = running_costs / runningCounter;
+            if (targetCosts > 0 && running_costs / runningCounter <= targetCosts){
+                epochsToTarget = epoch;
+                break;
+            }
             running_costs = 0.0;
             runningCounter = 0.0;
             runningRejectedpercentage = 0.0;
@@ -606,20 +1459,378 @@ void Environment::trainREINFORCE(int timeLimit, float lambdaTemporal, float lamb
     
     }
     std::cout<<"----- REINFORCE training finished -----"<<std::endl;
-    writeCostsToFile(averageCostVector, averageRejectionRateVector, lambdaTemporal, lambdaSpatial, true);
-    torch::save(assignmentNet,"src/assignmentNet_REINFORCE.pt");
-    std::cout<<"----- Policy net saved in src/assignmentNet_REINFORCE.pt -----"<<std::endl;
-    
+    trainRepositioning = false;
+    storage = requestedStorage;
+    if (data != primaryData){
+        useInstance(primaryData);
+    }
+    if (writeResults){
+        writeCostsToFile(averageCostVector, averageRejectionRateVector, lambdaTemporal, lambdaSpatial, true);
+        torch::save(assignmentNet, netFileName);
+        std::cout<<"----- Policy net saved in " << netFileName << " -----"<<std::endl;
+        if (repositioningNet){
+            torch::save(repositioningNet, repositioning.getNetFileName());
+            std::cout<<"----- Repositioning net saved in " << repositioning.getNetFileName() << " -----"<<std::endl;
+        }
+    }
+    return epochsToTarget;
 }
 
+torch::Tensor Environment::getAdvantages(torch::Tensor costs, const std::string& baseline, valueNetwork& critic, torch::optim::Adam& optimizerCritic, std::vector<double>& runningBaselines)
+{
+    torch::Tensor advantages;
+    if (baseline == "critic"){
+        // The critic is fitted to the discounted costs (scaled by the penalty) of the same states, and its estimate before the update is subtracted
+        torch::Tensor values = critic.forward(assingmentProblemStates).view({1, -1});
+        advantages = costs - values.detach() * data->penaltyForNotServing;
+        optimizerCritic.zero_grad();
+        torch::Tensor lossCritic = torch::mse_loss(values, costs / data->penaltyForNotServing);
+        lossCritic.backward();
+        optimizerCritic.step();
+    }else{
+        // The state is summarized by the nearest warehouse of the order, the first nbWarehouses entries of a state are the travel times to the warehouses
+        torch::Tensor nearestWarehouses = assingmentProblemStates.narrow(1, 0, data->nbWarehouses).argmin(1).contiguous();
+        const int64_t* nearest = nearestWarehouses.data_ptr<int64_t>();
+        torch::Tensor flatCosts = costs.flatten().contiguous();
+        const float* costsPtr = flatCosts.data_ptr<float>();
+        int nbDecisions = flatCosts.numel();
+        if (runningBaselines.empty()){
+            runningBaselines = std::vector<double>(nbPolicyWarehouses, -1.0);
+        }
+        std::vector<float> advantagesVec(nbDecisions);
+        std::vector<double> sums(nbPolicyWarehouses, 0.0);
+        std::vector<int> counts(nbPolicyWarehouses, 0);
+        for (int i = 0; i < nbDecisions; i++){
+            double baselineValue = runningBaselines[nearest[i]] < 0 ? 0.0 : runningBaselines[nearest[i]];
+            advantagesVec[i] = costsPtr[i] - baselineValue;
+            sums[nearest[i]] += costsPtr[i];
+            counts[nearest[i]]++;
+        }
+        // The baselines follow the costs of the last episodes with exponential smoothing
+        for (int w = 0; w < nbPolicyWarehouses; w++){
+            if (counts[w] == 0) continue;
+            double mean = sums[w] / counts[w];
+            runningBaselines[w] = runningBaselines[w] < 0 ? mean : 0.95 * runningBaselines[w] + 0.05 * mean;
+        }
+        auto options = torch::TensorOptions().dtype(at::kFloat);
+        advantages = torch::from_blob(advantagesVec.data(), {1, nbDecisions}, options).clone();
+    }
+    // Normalized advantages keep the step size of the policy independent of the scale of the costs
+    if (advantages.numel() > 1){
+        advantages = (advantages - advantages.mean()) / (advantages.std() + 1e-8);
+    }
+    return advantages;
+}
+
+void Environment::benchmarkREINFORCEBaseline(int timeLimit, float lambdaTemporal, float lambdaSpatial, double targetCosts, int nbEpochs)
+{
+    // Each variant starts from the same random numbers and the same initial weights
+    XorShift128 initialRng = rng;
+    std::vector<std::string> baselines = {"none", "running", "critic"};
+    std::vector<int> epochsToTarget;
+    std::vector<double> secondsToTarget;
+    for (const std::string& baseline : baselines){
+        rng = initialRng;
+        torch::manual_seed(0);
+        auto startTime = std::chrono::steady_clock::now();
+        epochsToTarget.push_back(runREINFORCE(timeLimit, lambdaTemporal, lambdaSpatial, baseline, nbEpochs, targetCosts, "", false));
+        secondsToTarget.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    }
+    std::cout<<"----- Time to reach average costs of " << targetCosts << " (at most " << nbEpochs << " epochs) -----"<<std::endl;
+    std::cout<<"Baseline Epochs Seconds Speedup"<<std::endl;
+    for (size_t i = 0; i < baselines.size(); i++){
+        if (epochsToTarget[i] == -1){
+            std::cout<< baselines[i] << " not_reached " << secondsToTarget[i] << " -" <<std::endl;
+        }else if (epochsToTarget[0] == -1){
+            std::cout<< baselines[i] << " " << epochsToTarget[i] << " " << secondsToTarget[i] << " -" <<std::endl;
+        }else{
+            std::cout<< baselines[i] << " " << epochsToTarget[i] << " " << secondsToTarget[i] << " " << secondsToTarget[0] / secondsToTarget[i] <<std::endl;
+        }
+    }
+}
+
+void Environment::benchmarkMixedPrecision(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbEpochs)
+{
+    // Both precisions start from the same random numbers and the same initial weights. Only the updates change, the episodes are simulated in fp32
+    XorShift128 initialRng = rng;
+    bool initialMixedPrecision = mixedPrecision;
+    std::vector<std::string> precisions = {"fp32", "bf16"};
+    std::vector<double> seconds, updateSeconds, averageCosts;
+    for (const std::string& precision : precisions){
+        rng = initialRng;
+        torch::manual_seed(0);
+        mixedPrecision = precision == "bf16";
+        auto startTime = std::chrono::steady_clock::now();
+        runREINFORCE(timeLimit, lambdaTemporal, lambdaSpatial, data->getOption("reinforceBaseline", "none"), nbEpochs, 0.0, "", false);
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+        updateSeconds.push_back(trainingUpdateTime);
+        averageCosts.push_back(trainingAverageCosts);
+    }
+    mixedPrecision = initialMixedPrecision;
+    std::cout<<"----- Training in fp32 and bf16 mixed precision (" << nbEpochs << " epochs) -----"<<std::endl;
+    std::cout<<"Precision Seconds UpdateSeconds UpdateSpeedup AverageCosts DifferenceToFp32"<<std::endl;
+    for (size_t i = 0; i < precisions.size(); i++){
+        std::cout<< precisions[i] << " " << seconds[i] << " " << updateSeconds[i] << " " << updateSeconds[0] / updateSeconds[i] << " " << averageCosts[i]
+                 << " " << (averageCosts[0] > 0 ? 100.0 * (averageCosts[i] - averageCosts[0]) / averageCosts[0] : 0.0) << "%" <<std::endl;
+    }
+}
+
+
+Trajectory Environment::generateTrajectory(int timeLimit, policyNetwork& n, float lambdaTemporal, float lambdaSpatial)
+{
+    // Training needs the orders of the whole episode for the discounted costs, but not the routes
+    EpisodeStorage requestedStorage = storage;
+    storage = STORE_ORDERS;
+    initialize(timeLimit);
+    simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderREINFORCE(newOrder, n, true); });
+    storage = requestedStorage;
+    Trajectory trajectory;
+    trajectory.states = assingmentProblemStates;
+    trajectory.actions = assingmentProblemActions;
+    trajectory.masks = assignmentProblemMasks;
+    trajectory.costs = getCostsVectorDiscountedAssignmentProblem(lambdaTemporal, lambdaSpatial);
+    trajectory.objValue = getObjValue();
+    trajectory.rejectionRate = (float)rejectCount/(float)getNbArrivalsDrawn();
+    trajectory.policyVersion = -1;
+    return trajectory;
+}
+
+double Environment::trainREINFORCEActorLearner(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbActors, int batchSize, int nbEpisodes, bool writeResults)
+{
+    std::cout<<"----- Actor-learner REINFORCE training starts with " << nbActors << " actors, batches of " << batchSize << " episodes, lambda temporal " << lambdaTemporal << " and lambda spatial " << lambdaSpatial << " -----"<<std::endl;
+    // The learner owns the policy net that is optimized, the actors simulate with their own copies of it
+    auto learnerNet = std::make_shared<policyNetwork>(nbPolicyWarehouses*5, nbPolicyWarehouses+1);
+    logLoss loss_fn;
+    torch::optim::Adam optimizerAssignmentNet(learnerNet->parameters(), /*lr=*/0.0002);
+
+    // The actors check the version of the published weights after each episode and copy them if they are newer
+    std::shared_ptr<const PolicyWeights> publishedWeights;
+    auto publishWeights = [&](int version){
+        auto weights = std::make_shared<PolicyWeights>();
+        weights->version = version;
+        for (const torch::Tensor& parameter : learnerNet->parameters()){
+            weights->parameters.push_back(parameter.detach().clone());
+        }
+        std::atomic_store(&publishedWeights, std::shared_ptr<const PolicyWeights>(weights));
+    };
+    int learnerVersion = 0;
+    publishWeights(learnerVersion);
+
+    // Bounded queue of generated episodes, actors wait when it is full such that the policy of queued episodes does not become too stale
+    int queueCapacity = 2;
+    while (queueCapacity < 2*std::max(batchSize, nbActors)) queueCapacity *= 2;
+    BoundedQueue<Trajectory> trajectories(queueCapacity);
+    std::atomic<bool> stop(false);
+    // The first exception of an actor stops the training and is rethrown by the learner
+    std::exception_ptr actorError;
+    std::mutex actorErrorMutex;
+
+    // Actors only run inference on one core each, the remaining cores are left to the learner
+    int nbCores = std::max(1, (int)std::thread::hardware_concurrency());
+    std::vector<std::thread> actors;
+    for (int a = 0; a < nbActors; a++){
+        actors.emplace_back([&, a](){
+            try{
+                torch::set_num_threads(1);
+                ThreadManager::global().pinSimulationThread(a);
+                torch::NoGradGuard noGrad;
+                // The actors share the data, each one simulates with its own random number generator
+                Environment actor(data);
+                actor.rng = XorShift128(a + 1);
+                auto actorNet = std::make_shared<policyNetwork>(nbPolicyWarehouses*5, nbPolicyWarehouses+1);
+                std::vector<torch::Tensor> actorParameters = actorNet->parameters();
+                int actorVersion = -1;
+                while (!stop.load()){
+                    std::shared_ptr<const PolicyWeights> weights = std::atomic_load(&publishedWeights);
+                    if (weights->version != actorVersion){
+                        for (size_t p = 0; p < actorParameters.size(); p++){
+                            actorParameters[p].copy_(weights->parameters[p]);
+                        }
+                        actorVersion = weights->version;
+                    }
+                    Trajectory trajectory = actor.generateTrajectory(timeLimit, *actorNet, lambdaTemporal, lambdaSpatial);
+                    trajectory.policyVersion = actorVersion;
+                    // The queue is closed when the training stops
+                    if (!trajectories.push(trajectory)) return;
+                }
+            }catch (...){
+                {
+                    std::lock_guard<std::mutex> lock(actorErrorMutex);
+                    if (!actorError) actorError = std::current_exception();
+                }
+                stop.store(true);
+                trajectories.close();
+            }
+        });
+    }
+    // Stop the actors, they may wait for space in the queue
+    auto stopActors = [&](){
+        stop.store(true);
+        trajectories.close();
+        for (std::thread& actor : actors){
+            actor.join();
+        }
+    };
+
+    double running_costs = 0.0;
+    double runningCounter = 0.0;
+    double runningRejectedpercentage = 0.0;
+    double totalStaleness = 0.0;
+    std::vector< float> averageCostVector;
+    std::vector< float> averageRejectionRateVector;
+    std::vector<Trajectory> batch;
+    auto startTime = std::chrono::steady_clock::now();
+    try{
+        torch::set_num_threads(ThreadManager::global().getNbInferenceThreads(std::max(1, nbCores - nbActors)));
+        for (int episode = 1; episode <= nbEpisodes; episode++) {
+            Trajectory trajectory;
+            // The queue is only closed before the end if an actor failed
+            if (!trajectories.pop(trajectory)) break;
+            running_costs += trajectory.objValue;
+            runningRejectedpercentage += trajectory.rejectionRate;
+            runningCounter += 1;
+            averageCostsMetric->set(running_costs / runningCounter);
+            totalStaleness += learnerVersion - trajectory.policyVersion;
+            batch.push_back(std::move(trajectory));
+
+            if ((int)batch.size() == batchSize || episode == nbEpisodes){
+                // One update of the learner on all episodes of the batch
+                std::vector<torch::Tensor> states, actions, masks, costs;
+                for (const Trajectory& t : batch){
+                    // An episode without any sampled decision adds nothing to the update
+                    if (!t.states.defined()) continue;
+                    states.push_back(t.states);
+                    actions.push_back(t.actions);
+                    masks.push_back(t.masks);
+                    costs.push_back(t.costs);
+                }
+                if (!states.empty()){
+                    optimizerAssignmentNet.zero_grad();
+                    torch::Tensor predAsssignment = learnerNet->forward(torch::cat(states), mixedPrecision);
+                    auto resultAssignment = getMaskedProbabilities(predAsssignment, torch::cat(actions), torch::cat(masks));
+                    torch::Tensor lossAssignmentNet = loss_fn.forward(resultAssignment, torch::cat(costs, 1));
+                    lossAssignmentNet.backward();
+                    optimizerAssignmentNet.step();
+                    lossMetric->set(lossAssignmentNet.item<float>());
+                    learnerVersion++;
+                    publishWeights(learnerVersion);
+                }
+                batch.clear();
+            }
+
+            if (episode % 100 == 0) {
+                std::cout << "[Iteration: " << episode << "] Average costs: " << running_costs / runningCounter << " Rejected requests:" << runningRejectedpercentage / runningCounter << std::endl;
+                averageCostVector.push_back(running_costs/runningCounter);
+                averageRejectionRateVector.push_back(runningRejectedpercentage / runningCounter);
+                running_costs = 0.0;
+                runningCounter = 0.0;
+                runningRejectedpercentage = 0.0;
+            }
+        }
+    }catch (...){
+        stopActors();
+        throw;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    stopActors();
+    if (actorError){
+        std::rethrow_exception(actorError);
+    }
+    double episodesPerSecond = nbEpisodes / seconds;
+    std::cout<<"----- Actor-learner training finished: " << episodesPerSecond << " episodes per second, average policy staleness " << totalStaleness / nbEpisodes << " updates -----"<<std::endl;
+    if (writeResults){
+        // Actor a simulates with the seed a + 1
+        runSeed = "actors:1-" + std::to_string(nbActors);
+        writeCostsToFile(averageCostVector, averageRejectionRateVector, lambdaTemporal, lambdaSpatial, true);
+        torch::save(learnerNet,"src/assignmentNet_REINFORCE.pt");
+        std::cout<<"----- Policy net saved in src/assignmentNet_REINFORCE.pt -----"<<std::endl;
+    }
+    return episodesPerSecond;
+}
+
+void Environment::benchmarkThreadLayouts(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbActors, int nbEpisodes)
+{
+    // The actors are the simulation threads and the learner runs inference and the updates. The split gives the actors cores of their own
+    // and the learner the others. The intra-op threads of the learner keep the CPUs they were created with, so each layout is measured in
+    // a process of its own that creates them after it is pinned, and returns its episodes per second in shared memory
+    ThreadManager& threadManager = ThreadManager::global();
+    std::vector<std::pair<std::string, int>> layouts = {{"none", 0}, {"core", 0}, {"numa", 0}, {"core", nbActors}};
+    double* results = (double*)mmap(nullptr, layouts.size() * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED){
+        throw std::runtime_error("Could not map shared memory for the thread layouts");
+    }
+    std::vector<double> episodesPerSecond;
+    for (size_t i = 0; i < layouts.size(); i++){
+        results[i] = 0.0;
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0){
+            throw std::runtime_error("Could not fork the process of a thread layout");
+        }
+        if (pid == 0){
+            int exitCode = 0;
+            try{
+                threadManager.setLayout(layouts[i].first, layouts[i].second);
+                threadManager.pinInferenceThread();
+                torch::set_num_threads(threadManager.getNbInferenceThreads(torch::get_num_threads()));
+                std::cout<<"----- Layout: " << threadManager.describe() << " -----"<<std::endl;
+                results[i] = trainREINFORCEActorLearner(timeLimit, lambdaTemporal, lambdaSpatial, nbActors, 4, nbEpisodes, false);
+            }catch (const std::exception& exception){
+                std::cerr<<"----- Layout " << layouts[i].first << " " << layouts[i].second << " failed: " << exception.what() << " -----"<<std::endl;
+                exitCode = 1;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            _exit(exitCode);
+        }
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR){}
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+            std::cout<<"----- The process of layout " << layouts[i].first << " " << layouts[i].second << " did not finish, its episodes per second are 0 -----"<<std::endl;
+        }
+        episodesPerSecond.push_back(results[i]);
+    }
+    munmap(results, layouts.size() * sizeof(double));
+    std::cout<<"----- Thread layouts with " << nbActors << " actors (" << nbEpisodes << " episodes each) -----"<<std::endl;
+    std::cout<<"Pinning SimulationCores Episodes/s Speedup"<<std::endl;
+    for (size_t i = 0; i < layouts.size(); i++){
+        std::cout<< layouts[i].first << " " << layouts[i].second << " " << episodesPerSecond[i] << " " << (episodesPerSecond[0] > 0 ? episodesPerSecond[i] / episodesPerSecond[0] : 0.0) <<std::endl;
+    }
+}
+
+void Environment::benchmarkActorLearner(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbEpisodes)
+{
+    int nbCores = std::max(1, (int)std::thread::hardware_concurrency());
+    std::vector<int> actorCounts;
+    for (int nbActors = 1; nbActors < nbCores; nbActors *= 2){
+        actorCounts.push_back(nbActors);
+    }
+    if (actorCounts.empty() || actorCounts.back() != std::max(1, nbCores - 1)){
+        actorCounts.push_back(std::max(1, nbCores - 1));
+    }
+
+    std::vector<double> episodesPerSecond;
+    for (int nbActors : actorCounts){
+        episodesPerSecond.push_back(trainREINFORCEActorLearner(timeLimit, lambdaTemporal, lambdaSpatial, nbActors, 4, nbEpisodes, false));
+    }
+    std::cout<<"----- Actor-learner scaling on " << nbCores << " cores (" << nbEpisodes << " episodes each) -----"<<std::endl;
+    std::cout<<"Actors Episodes/s Speedup"<<std::endl;
+    for (size_t i = 0; i < actorCounts.size(); i++){
+        std::cout<< actorCounts[i] << " " << episodesPerSecond[i] << " " << episodesPerSecond[i] / episodesPerSecond[0] <<std::endl;
+    }
+}
 
 void Environment::testREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial)
 {
     std::cout<<"----- Testing REINFORCE starts -----"<<std::endl;
     // Load neural network
-    auto net = std::make_shared<policyNetwork>(data->nbWarehouses*5, data->nbWarehouses+1);
+    auto net = std::make_shared<policyNetwork>(nbPolicyWarehouses*5, nbPolicyWarehouses+1);
     torch::load(net, "src/assignmentNet_REINFORCE.pt");
     net->eval();
+    // Cached actions belong to the net they were computed with
+    if (decisionCache){
+        decisionCache->clear();
+    }
     
     double running_costs = 0.0;
     double runningCounter = 0.0;
@@ -627,70 +1838,39 @@ void Environment::testREINFORCE(int timeLimit, float lambdaTemporal, float lambd
     std::vector< float> averageRejectionRateVector;
     std::vector< float> meanWaitingTimeVector;
     std::vector< float> maxWaitingTimeVector;
-    for (int epoch = 1; epoch <= 1000; epoch++) {
+    std::vector< std::vector<int>> waitingTimeQuantileVector;
+    WaitingTimeHistogram allWaitingTimes;
+    std::vector<WarehouseStatistics> allWarehouseStatistics;
+    startEvaluation();
+    for (int epoch = 1; epoch <= maxEpochs; epoch++) {
         // Initialize data structures
+        startScenario();
         initialize(timeLimit);
         // Start with simulation
-        int counter = 0;
-        currentTime = 0;
-        timeCustomerArrives = 0;
-        timeNextCourierArrivesAtOrder = INT_MAX;
-        while (currentTime < timeLimit || ordersAssignedToCourierButNotServed.size() > 0){
-            // Keep track of current time
-            if (counter == orderTimes.size()-1){
-                currentTime = timeNextCourierArrivesAtOrder;
-            }else{
-                currentTime = std::min(timeCustomerArrives, timeNextCourierArrivesAtOrder);
-            }
-            if (timeCustomerArrives < timeNextCourierArrivesAtOrder && currentTime <= timeLimit && counter<orderTimes.size()-1){
-                timeCustomerArrives += orderTimes[counter];
-                currentTime = timeCustomerArrives;
-                counter += 1;
-                // Draw new order and assign it to warehouse, picker and courier. MUST BE IN THAT ORDER!!!
-                Order* newOrder = new Order;
-                initOrder(timeCustomerArrives, newOrder);
-                orders.push_back(newOrder);
-                // We immediately assign the order to a warehouse and a picker
-                chooseWarehouseForOrderREINFORCE(newOrder, *net, false);
-                if (newOrder->accepted){
-                    choosePickerForOrder(newOrder);
-                    // If there are couriers assigned to the warehouse, we can assign a courier to the order
-                    if (newOrder->assignedWarehouse->couriersAssigned.size()>0){
-                        chooseCourierForOrder(newOrder);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, newOrder);
-                    }else{ // else we add the order to list of orders that have not been assigned to a courier yet
-                        newOrder->assignedWarehouse->ordersNotAssignedToCourier.push_back(newOrder);  
-                    }
-                }
-            }else { // when a courier arrives at an order
-                if (nextOrderBeingServed){
-                    Courier* c = nextOrderBeingServed->assignedCourier;
-                    // We choose a warehouse for the courier
-                    chooseClosestWarehouseForCourier(c);
-                    // If the chosen warehouse has order that have not been assigned to a courier yet, we can now assign the order to a courier
-                    if (c->assignedToWarehouse->ordersNotAssignedToCourier.size()>0){
-                        Order* orderToAssignToCourier = c->assignedToWarehouse->ordersNotAssignedToCourier[0];
-                        chooseCourierForOrder(orderToAssignToCourier);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, orderToAssignToCourier);
-                    }
-                }
-            }
-        }
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderREINFORCE(newOrder, *net, false); });
         running_costs += getObjValue();
         runningCounter += 1;
         averageCostVector.push_back(getObjValue());
-        averageRejectionRateVector.push_back((float)rejectCount/(float)orderTimes.size());
+        averageRejectionRateVector.push_back((float)rejectCount/(float)getNbArrivalsDrawn());
         if (nbOrdersServed > 0){
             //std::cout<<"----- Iteration: " << epoch << " Number of orders that arrived: " << orders.size() << " and served: " << nbOrdersServed << " Obj. value: " << getObjValue() << ". Mean wt: " << totalWaitingTime/nbOrdersServed <<" seconds. Highest wt: " << highestWaitingTimeOfAnOrder <<" seconds. -----" <<std::endl;
-            meanWaitingTimeVector.push_back(totalWaitingTime/nbOrdersServed);
+            meanWaitingTimeVector.push_back((float)totalWaitingTime/nbOrdersServed);
             maxWaitingTimeVector.push_back(highestWaitingTimeOfAnOrder);
         }else{
             meanWaitingTimeVector.push_back(0);
             maxWaitingTimeVector.push_back(0);
         }
+        waitingTimeQuantileVector.push_back(getWaitingTimeQuantiles());
+        mergeEpisodeKpis(allWaitingTimes, allWarehouseStatistics);
+        if (!finishScenario(timeLimit, epoch, getObjValue())){
+            break;
+        }
     }
-    writeStatsToFile(averageCostVector, averageRejectionRateVector, meanWaitingTimeVector, maxWaitingTimeVector, lambdaTemporal, lambdaSpatial, false, false);
+    writeStatsToFile(averageCostVector, averageRejectionRateVector, meanWaitingTimeVector, maxWaitingTimeVector, waitingTimeQuantileVector, lambdaTemporal, lambdaSpatial, false, false);
+    writeKpisToFile(getKpiFileName(std::to_string(lambdaTemporal) + "_" + std::to_string(lambdaSpatial)), allWaitingTimes, allWarehouseStatistics);
     std::cout<< "Iterations: " << runningCounter << " Average costs: " << running_costs / runningCounter <<std::endl;
+    std::cout<< "Waiting time P50: " << allWaitingTimes.quantile(0.5) << " P90: " << allWaitingTimes.quantile(0.9) << " P95: " << allWaitingTimes.quantile(0.95) << " P99: " << allWaitingTimes.quantile(0.99) << " seconds" <<std::endl;
+    reportEvaluation();
     
 }
 
@@ -703,86 +1883,355 @@ void Environment::nearestWarehousePolicy(int timeLimit)
     std::vector< float> averageRejectionRateVector;
     std::vector< float> meanWaitingTimeVector;
     std::vector< float> maxWaitingTimeVector;
-    for (int epoch = 1; epoch <= 1000; epoch++) {
+    std::vector< std::vector<int>> waitingTimeQuantileVector;
+    WaitingTimeHistogram allWaitingTimes;
+    std::vector<WarehouseStatistics> allWarehouseStatistics;
+    startEvaluation();
+    for (int epoch = 1; epoch <= maxEpochs; epoch++) {
         // Initialize data structures
+        startScenario();
         initialize(timeLimit);
         
         // Start with simulation
-        int counter = 0;
-        currentTime = 0;
-        timeCustomerArrives = 0;
-        timeNextCourierArrivesAtOrder = INT_MAX;
-        while (currentTime < timeLimit || ordersAssignedToCourierButNotServed.size() > 0){
-            // Keep track of current time
-            if (counter == orderTimes.size()-1){
-                currentTime = timeNextCourierArrivesAtOrder;
-            }else{
-                currentTime = std::min(timeCustomerArrives, timeNextCourierArrivesAtOrder);
-            }
-
-            if (timeCustomerArrives < timeNextCourierArrivesAtOrder && currentTime <= timeLimit && counter<orderTimes.size()-1){
-                timeCustomerArrives += orderTimes[counter];
-                currentTime = timeCustomerArrives;
-                counter += 1;
-                // Draw new order and assign it to warehouse, picker and courier. MUST BE IN THAT ORDER!!!
-                Order* newOrder = new Order;
-                initOrder(timeCustomerArrives, newOrder);
-                orders.push_back(newOrder);
-                // We immediately assign the order to a warehouse and a picker
-                chooseClosestWarehouseForOrder(newOrder);
-                if (newOrder->accepted){
-                    choosePickerForOrder(newOrder);
-                    // If there are couriers assigned to the warehouse, we can assign a courier to the order
-                    if (newOrder->assignedWarehouse->couriersAssigned.size()>0){
-                        chooseCourierForOrder(newOrder);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, newOrder);
-                    }else{ // else we add the order to list of orders that have not been assigned to a courier yet
-                        newOrder->assignedWarehouse->ordersNotAssignedToCourier.push_back(newOrder);    
-                    }
-                }
-            }else { // when a courier arrives at an order
-                if (nextOrderBeingServed){
-                    Courier* c = nextOrderBeingServed->assignedCourier;
-                    // We choose a warehouse for the courier
-                    chooseClosestWarehouseForCourier(c);
-                    // If the chosen warehouse has order that have not been assigned to a courier yet, we can now assign the order to a courier
-                    if (c->assignedToWarehouse->ordersNotAssignedToCourier.size()>0){
-                        Order* orderToAssignToCourier = c->assignedToWarehouse->ordersNotAssignedToCourier[0];
-                        chooseCourierForOrder(orderToAssignToCourier);
-                        AddOrderToVector(ordersAssignedToCourierButNotServed, orderToAssignToCourier);
-                    }
-                }
-            }
-        }
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseClosestWarehouseForOrder(newOrder); });
         running_costs += getObjValue();
         runningCounter += 1;
         averageCostVector.push_back(getObjValue());
-        averageRejectionRateVector.push_back((float)rejectCount/(float)orderTimes.size());
+        averageRejectionRateVector.push_back((float)rejectCount/(float)getNbArrivalsDrawn());
         if (nbOrdersServed > 0){
             //std::cout<<"----- Iteration: " << epoch << " Number of orders that arrived: " << orders.size() << " and served: " << nbOrdersServed << " Obj. value: " << getObjValue() << ". Mean wt: " << totalWaitingTime/nbOrdersServed <<" seconds. Highest wt: " << highestWaitingTimeOfAnOrder <<" seconds. -----" <<std::endl;
-            meanWaitingTimeVector.push_back(totalWaitingTime/nbOrdersServed);
+            meanWaitingTimeVector.push_back((float)totalWaitingTime/nbOrdersServed);
             maxWaitingTimeVector.push_back(highestWaitingTimeOfAnOrder);
         }else{
             meanWaitingTimeVector.push_back(0);
             maxWaitingTimeVector.push_back(0);
         }
+        waitingTimeQuantileVector.push_back(getWaitingTimeQuantiles());
+        mergeEpisodeKpis(allWaitingTimes, allWarehouseStatistics);
+        if (!finishScenario(timeLimit, epoch, getObjValue())){
+            break;
+        }
         //std::cout<<"----- Simulation finished -----"<<std::endl;
         //std::cout<<"----- Number of orders that arrived: " << orders.size() << " and served: " << nbOrdersServed << " Obj. value: " << getObjValue() << ". Mean wt: " << totalWaitingTime/nbOrdersServed <<" seconds. Highest wt: " << highestWaitingTimeOfAnOrder <<" seconds. -----" <<std::endl;
         //writeRoutesAndOrdersToFile("data/animationData/routes.txt", "data/animationData/orders.txt");
     }
-    //writeStatsToFile(averageCostVector, averageRejectionRateVector, meanWaitingTimeVector, maxWaitingTimeVector, 0, 0, false, true);
+    //writeStatsToFile(averageCostVector, averageRejectionRateVector, meanWaitingTimeVector, maxWaitingTimeVector, waitingTimeQuantileVector, 0, 0, false, true);
+    writeKpisToFile(getKpiFileName("NearestWarehousePolicy"), allWaitingTimes, allWarehouseStatistics);
     std::cout<< "Iterations: " << runningCounter <<" Average costs: " << running_costs / runningCounter <<std::endl;
+    std::cout<< "Waiting time P50: " << allWaitingTimes.quantile(0.5) << " P90: " << allWaitingTimes.quantile(0.9) << " P95: " << allWaitingTimes.quantile(0.95) << " P99: " << allWaitingTimes.quantile(0.99) << " seconds" <<std::endl;
+    reportEvaluation();
+}
+
+void Environment::assignBatch()
+{
+    auto startTime = std::chrono::steady_clock::now();
+    int nbOrders = ordersInBatch.size();
+
+    // The columns of the assignment problem are slots: the k-th slot of a warehouse is the k-th fastest available courier there.
+    // Slots beyond the number of orders in the batch are never needed. Afterwards, each order has a private reject column
+    std::vector<std::vector<int>> courierTimes(data->nbWarehouses);
+    std::vector<std::vector<int>> pickerTimes(data->nbWarehouses);
+    std::vector<int> slotStart(data->nbWarehouses + 1, 0);
+    for (int w = 0; w < data->nbWarehouses; w++){
+        for (Courier* courier : warehouses[w]->couriersAssigned){
+            courierTimes[w].push_back(courier->timeWhenAvailable);
+        }
+        for (Picker* picker : warehouses[w]->pickersAssigned){
+            pickerTimes[w].push_back(picker->timeWhenAvailable);
+        }
+        std::sort(courierTimes[w].begin(), courierTimes[w].end());
+        std::sort(pickerTimes[w].begin(), pickerTimes[w].end());
+        if ((int)courierTimes[w].size() > nbOrders) courierTimes[w].resize(nbOrders);
+        slotStart[w + 1] = slotStart[w] + courierTimes[w].size();
+    }
+    int nbSlots = slotStart[data->nbWarehouses];
+
+    // Each order only gets edges to the slots of its nearest warehouses that have couriers, and only if serving it is cheaper than rejecting it
+    auctionSolver.reset(nbOrders, nbSlots + nbOrders);
+    std::vector<int> candidates;
+    for (int i = 0; i < nbOrders; i++){
+        Order* order = ordersInBatch[i];
+        const int* distancesToWarehouses = data->travelTime.getRowData(order->client->clientID, currentTime);
+        uint64_t zones = getServiceZones(order);
+        candidates.clear();
+        for (int w = 0; w < data->nbWarehouses; w++){
+            if ((zones >> w & 1) && courierTimes[w].size() > 0 && pickerTimes[w].size() > 0) candidates.push_back(w);
+        }
+        int nbCandidates = std::min((int)candidates.size(), nbCandidateWarehousesInBatch);
+        std::partial_sort(candidates.begin(), candidates.begin() + nbCandidates, candidates.end(), [&](int a, int b){ return distancesToWarehouses[a] < distancesToWarehouses[b]; });
+        for (int c = 0; c < nbCandidates; c++){
+            int w = candidates[c];
+            int nbPickers = pickerTimes[w].size();
+            for (int k = 0; k < (int)courierTimes[w].size(); k++){
+                // The k-th order at a warehouse waits for the k-th fastest picker, or for a picker to finish another order if there are fewer pickers
+                int pickerReady = std::max(currentTime, pickerTimes[w][std::min(k, nbPickers - 1)]) + (int)(std::max(0, k - nbPickers + 1) * data->meanCommissionTime) + order->timeToComission;
+                int departureTime = std::max(currentTime, std::max(courierTimes[w][k], pickerReady));
+                int waitingTime = departureTime + data->travelTime.get(order->client->clientID, w, departureTime) - order->orderTime;
+                if (waitingTime < data->penaltyForNotServing){
+                    auctionSolver.addEdge(i, slotStart[w] + k, -waitingTime);
+                }
+            }
+        }
+        auctionSolver.addEdge(i, nbSlots + i, -data->penaltyForNotServing);
+    }
+
+    // With integer benefits and epsilon below 1/nbOrders the auction is optimal. The bids and the time per window are bounded
+    std::vector<int> assignment;
+    bool solved = auctionSolver.solve(assignment, 1.0/(nbOrders + 1), maxBidsPerBatch, batchTimeBudget);
+
+    // Apply the decisions warehouse by warehouse in slot order, such that the fastest couriers go to the orders of the first slots
+    std::vector<int> sequence(nbOrders);
+    for (int i = 0; i < nbOrders; i++){
+        sequence[i] = i;
+    }
+    std::stable_sort(sequence.begin(), sequence.end(), [&](int a, int b){ return (unsigned)assignment[a] < (unsigned)assignment[b]; });
+    for (int i : sequence){
+        Order* order = ordersInBatch[i];
+        if (assignment[i] == -1){
+            // The budget was exceeded before the order got a column, so it falls back to the nearest warehouse
+            chooseClosestWarehouseForOrder(order);
+        }else if (assignment[i] >= nbSlots){
+            order->accepted = false;
+            rejectCount++;
+        }else{
+            int w = std::upper_bound(slotStart.begin(), slotStart.end(), assignment[i]) - slotStart.begin() - 1;
+            order->assignedWarehouse = warehouses[w];
+            order->accepted = true;
+        }
+        dispatchOrder(order);
+    }
+    ordersInBatch.clear();
+
+    double solveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    totalBatchSolveTime += solveTime;
+    maxBatchSolveTime = std::max(maxBatchSolveTime, solveTime);
+    nbBatches++;
+    if (!solved) nbBatchesOverBudget++;
+}
+
+void Environment::batchAssignmentPolicy(int timeLimit, int windowLength)
+{
+    std::cout<<"----- Batch assignment with windows of " << windowLength << " seconds starts -----"<<std::endl;
+    double running_costs = 0.0;
+    double runningCounter = 0.0;
+    totalBatchSolveTime = 0.0;
+    maxBatchSolveTime = 0.0;
+    nbBatches = 0;
+    nbBatchesOverBudget = 0;
+    WaitingTimeHistogram allWaitingTimes;
+    std::vector<WarehouseStatistics> allWarehouseStatistics;
+    startEvaluation();
+    for (int epoch = 1; epoch <= maxEpochs; epoch++) {
+        // Initialize data structures
+        startScenario();
+        initialize(timeLimit);
+        // Start with simulation
+        simulateEpisode(timeLimit, nullptr, windowLength);
+        running_costs += getObjValue();
+        runningCounter += 1;
+        mergeEpisodeKpis(allWaitingTimes, allWarehouseStatistics);
+        if (!finishScenario(timeLimit, epoch, getObjValue())){
+            break;
+        }
+    }
+    writeKpisToFile(getKpiFileName("BatchAssignment_" + std::to_string(windowLength)), allWaitingTimes, allWarehouseStatistics);
+    std::cout<< "Iterations: " << runningCounter <<" Average costs: " << running_costs / runningCounter <<std::endl;
+    std::cout<< "Waiting time P50: " << allWaitingTimes.quantile(0.5) << " P90: " << allWaitingTimes.quantile(0.9) << " P95: " << allWaitingTimes.quantile(0.95) << " P99: " << allWaitingTimes.quantile(0.99) << " seconds" <<std::endl;
+    reportEvaluation();
+    std::cout<< "Windows: " << nbBatches << " Mean solve time: " << 1000*totalBatchSolveTime / std::max(1, nbBatches) << " ms. Max solve time: " << 1000*maxBatchSolveTime << " ms. Windows over budget: " << nbBatchesOverBudget <<std::endl;
+}
+
+void Environment::rolloutPolicy(int timeLimit)
+{
+    std::cout<<"----- Rollout policy with " << nbRolloutCandidates << " candidate warehouses, a horizon of " << rolloutHorizon << " seconds and up to " << maxRolloutScenarios << " scenarios per decision starts -----"<<std::endl;
+    double running_costs = 0.0;
+    double runningCounter = 0.0;
+    nbRolloutDecisions = 0;
+    nbRolloutScenarios = 0;
+    totalRolloutTime = 0.0;
+    maxRolloutTime = 0.0;
+    WaitingTimeHistogram allWaitingTimes;
+    std::vector<WarehouseStatistics> allWarehouseStatistics;
+    startEvaluation();
+    for (int epoch = 1; epoch <= maxEpochs; epoch++) {
+        // Initialize data structures
+        startScenario();
+        initialize(timeLimit);
+        // Start with simulation
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderRollout(newOrder, timeLimit); });
+        running_costs += getObjValue();
+        runningCounter += 1;
+        mergeEpisodeKpis(allWaitingTimes, allWarehouseStatistics);
+        if (!finishScenario(timeLimit, epoch, getObjValue())){
+            break;
+        }
+    }
+    writeKpisToFile(getKpiFileName("Rollout_" + std::to_string(rolloutHorizon)), allWaitingTimes, allWarehouseStatistics);
+    std::cout<< "Iterations: " << runningCounter <<" Average costs: " << running_costs / runningCounter <<std::endl;
+    std::cout<< "Waiting time P50: " << allWaitingTimes.quantile(0.5) << " P90: " << allWaitingTimes.quantile(0.9) << " P95: " << allWaitingTimes.quantile(0.95) << " P99: " << allWaitingTimes.quantile(0.99) << " seconds" <<std::endl;
+    reportEvaluation();
+    std::cout<< "Decisions: " << nbRolloutDecisions << " Mean scenarios per candidate: " << (double)nbRolloutScenarios / std::max(1L, nbRolloutDecisions) << " Mean decision time: " << 1000*totalRolloutTime / std::max(1L, nbRolloutDecisions) << " ms. Max decision time: " << 1000*maxRolloutTime << " ms." <<std::endl;
+}
+
+ReplicationRecord Environment::simulateReplication(char *argv[], int timeLimit, int seed)
+{
+    std::string method(argv[5]);
+    return simulateReplication(method, timeLimit, seed, (method == "batchAssignment" && argv[6]) ? std::stoi(argv[6]) : 30);
+}
+
+ReplicationRecord Environment::simulateReplication(const std::string& method, int timeLimit, int seed, int batchWindow)
+{
+    // Each replication starts from its own seed, so its random numbers do not depend on which process simulates it or in which order
+    rng = XorShift128(seed);
+    initialize(timeLimit);
+    // The scenarios of the rollouts also follow the seed, not the number of episodes this process simulated before
+    rolloutSeed = seed;
+    decisionCacheStatistics = DecisionCacheStatistics();
+    if (method == "nearestWarehouse"){
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseClosestWarehouseForOrder(newOrder); });
+    }else if (method == "testREINFORCE"){
+        if (!replicationNet){
+            replicationNet = std::make_shared<policyNetwork>(nbPolicyWarehouses*5, nbPolicyWarehouses+1);
+            torch::load(replicationNet, "src/assignmentNet_REINFORCE.pt");
+            replicationNet->eval();
+            if (decisionCache){
+                decisionCache->clear();
+            }
+        }
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderREINFORCE(newOrder, *replicationNet, false); });
+    }else if (method == "batchAssignment"){
+        simulateEpisode(timeLimit, nullptr, batchWindow);
+    }else if (method == "rollout"){
+        simulateEpisode(timeLimit, [&](Order* newOrder){ chooseWarehouseForOrderRollout(newOrder, timeLimit); });
+    }else{
+        throw std::invalid_argument("Method " + method + " cannot be replicated");
+    }
+
+    ReplicationRecord record;
+    record.objValue = getObjValue();
+    record.rejectionRate = (float)rejectCount/(float)getNbArrivalsDrawn();
+    record.meanWaitingTime = nbOrdersServed > 0 ? (float)totalWaitingTime/nbOrdersServed : 0;
+    record.maxWaitingTime = nbOrdersServed > 0 ? highestWaitingTimeOfAnOrder : 0;
+    std::vector<int> quantiles = getWaitingTimeQuantiles();
+    std::copy(quantiles.begin(), quantiles.end(), record.waitingTimeQuantiles);
+    record.decisionCache = decisionCacheStatistics;
+    record.epoch = -1;
+    record.seed = seed;
+    return record;
+}
+
+void Environment::getEpisodeKpis(WaitingTimeHistogram& episodeWaitingTimes, WarehouseStatistics* episodeWarehouseStatistics)
+{
+    episodeWaitingTimes = waitingTimes;
+    std::copy(warehouseStatistics.begin(), warehouseStatistics.end(), episodeWarehouseStatistics);
+}
+
+void Environment::writeReplicationsToFile(char *argv[], const std::vector<ReplicationRecord>& records, const WaitingTimeHistogram& allWaitingTimes, const std::vector<WarehouseStatistics>& allWarehouseStatistics)
+{
+    std::vector<float> costs, rejectionRates, meanWaitingTimes, maxWaitingTimes;
+    std::vector<std::vector<int>> waitingTimeQuantiles;
+    std::vector<int> epochs, seeds;
+    for (const ReplicationRecord& record : records){
+        epochs.push_back(record.epoch);
+        seeds.push_back(record.seed);
+        costs.push_back(record.objValue);
+        rejectionRates.push_back(record.rejectionRate);
+        meanWaitingTimes.push_back(record.meanWaitingTime);
+        maxWaitingTimes.push_back(record.maxWaitingTime);
+        waitingTimeQuantiles.push_back(std::vector<int>(record.waitingTimeQuantiles, record.waitingTimeQuantiles + 4));
+    }
+    // Same files as the evaluation in one process, the other methods get a statsData file named after them
+    std::string method(argv[5]);
+    if (method == "nearestWarehouse"){
+        writeStatsToFile(costs, rejectionRates, meanWaitingTimes, maxWaitingTimes, waitingTimeQuantiles, 0, 0, false, true, epochs, seeds);
+        writeKpisToFile(getKpiFileName("NearestWarehousePolicy"), allWaitingTimes, allWarehouseStatistics);
+    }else if (method == "testREINFORCE"){
+        float lambdaTemporal = std::stod(argv[6]);
+        float lambdaSpatial = std::stod(argv[7]);
+        writeStatsToFile(costs, rejectionRates, meanWaitingTimes, maxWaitingTimes, waitingTimeQuantiles, lambdaTemporal, lambdaSpatial, false, false, epochs, seeds);
+        writeKpisToFile(getKpiFileName(std::to_string(lambdaTemporal) + "_" + std::to_string(lambdaSpatial)), allWaitingTimes, allWarehouseStatistics);
+    }else{
+        std::string fileName = "data/experimentData/testData/statsData_" + std::to_string(data->penaltyForNotServing) + "_" + std::to_string(data->interArrivalTime) + "_" + method + ".txt";
+        writeStatsToFile(fileName, costs, rejectionRates, meanWaitingTimes, maxWaitingTimes, waitingTimeQuantiles, epochs, seeds);
+        if (method == "batchAssignment"){
+            writeKpisToFile(getKpiFileName("BatchAssignment_" + std::to_string(argv[6] ? std::stoi(argv[6]) : 30)), allWaitingTimes, allWarehouseStatistics);
+        }else{
+            writeKpisToFile(getKpiFileName("Rollout_" + std::to_string(rolloutHorizon)), allWaitingTimes, allWarehouseStatistics);
+        }
+    }
 }
 
 void Environment::simulate(char *argv[])
 {   
     int timeLimit = std::stoi(argv[2])*3600;
+    // Events are either recorded to a log or checked against a log that was recorded before with the same arguments
+    if (data->hasOption("eventLog")){
+        eventLog.reset(new EventLog(data->getOption("eventLog", ""), false, data->commandLine));
+    }else if (data->hasOption("replay")){
+        eventLog.reset(new EventLog(data->getOption("replay", ""), true, data->commandLine));
+    }
+    try{
+        runMethod(argv, timeLimit);
+        if (eventLog){
+            eventLog->finish();
+        }
+    }catch (const ReplayDivergence& divergence){
+        std::cerr<<"----- REPLAY DIVERGENCE: " << divergence.what() << " -----"<<std::endl;
+    }
+    eventLog.reset();
+}
+
+void Environment::runMethod(char *argv[], int timeLimit)
+{
+    // argv ends with a null pointer, no argument after it may be read
+    int nbArguments = 0;
+    while (argv[nbArguments] != nullptr){
+        nbArguments++;
+    }
+    auto hasArguments = [&](int nbNeeded, const std::string& usage){
+        if (nbArguments >= nbNeeded) return true;
+        std::cerr<<"Usage: " << argv[0] << " instance hours penalty interArrivalTime " << argv[5] << " " << usage <<std::endl;
+        return false;
+    };
+    const std::string lambdas = "lambdaTemporal lambdaSpatial";
     if (std::string(argv[5]) == "nearestWarehouse"){
+        if (compareWithBaseline){
+            std::cerr<<"--baseline compares a policy with the nearest warehouse policy, it cannot be used with nearestWarehouse"<<std::endl;
+            return;
+        }
         nearestWarehousePolicy(timeLimit);
     }else if (std::string(argv[5]) == "trainREINFORCE"){
+        if (!hasArguments(8, lambdas)) return;
         trainREINFORCE(timeLimit, std::stod(argv[6]), std::stod(argv[7]));
     }else if (std::string(argv[5]) == "testREINFORCE"){
+        if (!hasArguments(8, lambdas)) return;
         testREINFORCE(timeLimit, std::stod(argv[6]), std::stod(argv[7]));
+    }else if (std::string(argv[5]) == "batchAssignment"){
+        batchAssignmentPolicy(timeLimit, argv[6] ? std::stoi(argv[6]) : 30);
+    }else if (std::string(argv[5]) == "rollout"){
+        rolloutPolicy(timeLimit);
+    }else if (std::string(argv[5]) == "trainREINFORCEAsync"){
+        if (!hasArguments(8, lambdas + " [actors [batchSize]]")) return;
+        int nbActors = argv[8] ? std::stoi(argv[8]) : std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        int batchSize = nbArguments > 9 ? std::stoi(argv[9]) : 4;
+        trainREINFORCEActorLearner(timeLimit, std::stod(argv[6]), std::stod(argv[7]), nbActors, batchSize, 8000, true);
+    }else if (std::string(argv[5]) == "benchmarkREINFORCEBaseline"){
+        if (!hasArguments(9, lambdas + " targetCosts [epochs]")) return;
+        int nbEpochs = nbArguments > 9 ? std::stoi(argv[9]) : 8000;
+        benchmarkREINFORCEBaseline(timeLimit, std::stod(argv[6]), std::stod(argv[7]), std::stod(argv[8]), nbEpochs);
+    }else if (std::string(argv[5]) == "benchmarkActorLearner"){
+        if (!hasArguments(8, lambdas + " [episodes]")) return;
+        int nbEpisodes = argv[8] ? std::stoi(argv[8]) : 400;
+        benchmarkActorLearner(timeLimit, std::stod(argv[6]), std::stod(argv[7]), nbEpisodes);
+    }else if (std::string(argv[5]) == "benchmarkMixedPrecision"){
+        if (!hasArguments(8, lambdas + " [epochs]")) return;
+        int nbEpochs = argv[8] ? std::stoi(argv[8]) : 1000;
+        benchmarkMixedPrecision(timeLimit, std::stod(argv[6]), std::stod(argv[7]), nbEpochs);
+    }else if (std::string(argv[5]) == "benchmarkThreadLayouts"){
+        if (!hasArguments(8, lambdas + " [actors [episodes]]")) return;
+        int nbActors = argv[8] ? std::stoi(argv[8]) : std::max(1, (int)std::thread::hardware_concurrency() / 2);
+        int nbEpisodes = nbArguments > 9 ? std::stoi(argv[9]) : 400;
+        benchmarkThreadLayouts(timeLimit, std::stod(argv[6]), std::stod(argv[7]), nbActors, nbEpisodes);
     }else{
         std::cerr<<"Method: " << argv[5] << " not found."<<std::endl;
     }
@@ -9,14 +9,66 @@
 #include <ctime>
 #include <chrono>
 #include <random>
+#include <functional>
+#include <memory>
 
 #include <torch/torch.h>
 #include <torch/script.h>
 #include "Matrix.h"
 #include "Data.h"
+#include "AuctionSolver.h"
+#include "CourierRepositioning.h"
+#include "DecisionCache.h"
+#include "EventLog.h"
+#include "KpiStatistics.h"
+#include "Metrics.h"
+#include "SimulationState.h"
+#include "ThreadPool.h"
+#include "WarehouseKernels.h"
 #include "Environment.h"
 
 struct policyNetwork;
+struct valueNetwork;
+
+// Structure of an episode that a simulation actor generated with (a possibly stale copy of) the policy net
+struct Trajectory
+{
+	torch::Tensor states;						// States of all assignment decisions of the episode
+	torch::Tensor actions;						// Actions that were sampled in these states
+	torch::Tensor masks;						// Outputs of the policy net each action was sampled from (1) or not (0)
+	torch::Tensor costs;						// Discounted costs of each action
+	int objValue;								// Objective value of the episode
+	float rejectionRate;						// Share of rejected orders of the episode
+	int policyVersion;							// Version of the policy net weights the episode was generated with
+};
+
+// Structure of a version of the policy net weights that the learner publishes to the actors
+struct PolicyWeights
+{
+	int version;								// Version number, increased with every update of the learner
+	std::vector<torch::Tensor> parameters;		// Copy of the parameters of the policy net
+};
+
+// What an episode keeps of the orders and routes it simulates
+enum EpisodeStorage
+{
+	STORE_ALL,									// All orders and the routes of the couriers (for the route and order files)
+	STORE_ORDERS,								// All orders but no routes, e.g., in training, which needs the orders for the discounted costs
+	STORE_STATISTICS							// Only the orders in the system, finished ones are folded into the statistics (--streaming)
+};
+
+// Structure of the results of one replication (epoch) of an evaluating method. Plain data, so it can be exchanged between processes
+struct ReplicationRecord
+{
+	long long objValue;							// Costs of the replication
+	float rejectionRate;						// Share of rejected orders
+	float meanWaitingTime;						// Mean and maximum waiting time of the served orders
+	int maxWaitingTime;
+	int waitingTimeQuantiles[4];				// 50, 90, 95 and 99 percent quantiles of the waiting times
+	DecisionCacheStatistics decisionCache;		// Decisions of the replication that went through the decision cache
+	int epoch;									// Index of the epoch of the replication and the seed of its random numbers
+	int seed;
+};
 
 class Environment
 {
@@ -26,9 +78,45 @@ public:
 
 	// Function to perform a simulation
 	void simulate(char * argv[]);
+	// Function that runs the method given on the command line
+	void runMethod(char * argv[], int timeLimit);
+
+	// In this method we apply the nearest warehouse policy.
+	void nearestWarehousePolicy(int timelimit);
+	// In these methods we train and test a REINFORCE algorithm. The trained policy net is saved in netFileName
+	void trainREINFORCE(int timelimit, float lambdaTemporal, float lambdaSpatial, std::string netFileName = "src/assignmentNet_REINFORCE.pt");
+	void testREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial);
+	// In this method we train REINFORCE with asynchronous simulation actors and one learner. Returns the number of episodes per second
+	double trainREINFORCEActorLearner(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbActors, int batchSize, int nbEpisodes, bool writeResults);
+	// In this method we buffer arriving orders over windows of windowLength seconds and assign each window jointly with an auction
+	void batchAssignmentPolicy(int timeLimit, int windowLength);
+	// In this method we look ahead before each assignment: the nearest warehouses and rejecting are each simulated on sampled future arrivals
+	void rolloutPolicy(int timeLimit);
+	// In this method we measure how long the training takes with each REINFORCE baseline until the average costs of 100 episodes reach targetCosts
+	void benchmarkREINFORCEBaseline(int timeLimit, float lambdaTemporal, float lambdaSpatial, double targetCosts, int nbEpochs);
+	// In this method we measure how the episodes per second of the actor-learner training scale with the number of actors
+	void benchmarkActorLearner(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbEpisodes);
+	// In this method we measure the episodes per second of the actor-learner training under different layouts of the threads on the cores
+	void benchmarkThreadLayouts(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbActors, int nbEpisodes);
+	// In this method we train REINFORCE in fp32 and in bf16 mixed precision from the same start and compare the time of the updates and the costs
+	void benchmarkMixedPrecision(int timeLimit, float lambdaTemporal, float lambdaSpatial, int nbEpochs);
+
+	// Function that simulates one replication of the evaluating method of argv[5] on the random numbers of seed (used by the replication runner)
+	ReplicationRecord simulateReplication(char * argv[], int timeLimit, int seed);
+	// Same for a method given by name (nearestWarehouse, testREINFORCE, batchAssignment or rollout), with the window length of batchAssignment
+	ReplicationRecord simulateReplication(const std::string& method, int timeLimit, int seed, int batchWindow = 30);
+	// Function that copies the waiting times and the counters of each warehouse (data->nbWarehouses entries) of the last episode, e.g., of a replication
+	void getEpisodeKpis(WaitingTimeHistogram& episodeWaitingTimes, WarehouseStatistics* episodeWarehouseStatistics);
+	// Function that writes the records of all replications of the method of argv[5] to its statsData file, and their merged waiting times and
+	// warehouse counters to its kpiData file
+	void writeReplicationsToFile(char * argv[], const std::vector<ReplicationRecord>& records, const WaitingTimeHistogram& allWaitingTimes, const std::vector<WarehouseStatistics>& allWarehouseStatistics);
+
+	// Destructor
+	~Environment();
 
 private:
 	Data* data;													// Problem parameters
+	XorShift128 rng;											// Random number generator of the episodes, starts from the one of the instance
 	std::vector<Order*> orders;									// Vector of pointers to orders. containing information on each order
 	std::vector<Order*> ordersAssignedToCourierButNotServed;	// Vector of orders that have not been served yet
 	std::vector<Warehouse*> warehouses;							// Vector of pointers containing information on each warehouse
@@ -45,21 +133,122 @@ private:
 	int rejectCount;
 	int timeCustomerArrives;
 	int timeNextCourierArrivesAtOrder;
-	int totalWaitingTime;
+	long long totalWaitingTime;
 	int highestWaitingTimeOfAnOrder;
 	int latestArrivalTime;
+	std::vector<Order*> ordersInBatch;							// Orders that arrived in the current batch window and wait for their assignment
+	int batchWindowEnd;											// Time at which the current batch window closes
+	int nbCandidateWarehousesInBatch;							// Number of nearest warehouses an order of a batch can be assigned to
+	long maxBidsPerBatch;										// Maximum number of auction bids per batch window
+	double batchTimeBudget;										// Maximum solve time per batch window (in seconds)
+	AuctionSolver auctionSolver;								// Solver of the assignment problem of a batch window
+	double totalBatchSolveTime;									// Total and maximum time to solve a batch window (in seconds)
+	double maxBatchSolveTime;
+	int nbBatches;												// Number of batch windows and those where the solver exceeded the budget
+	int nbBatchesOverBudget;
+	int rolloutHorizon;											// Seconds of future arrivals that a rollout simulates after a decision
+	int nbRolloutCandidates;									// Number of nearest warehouses that are evaluated with rollouts (besides rejecting)
+	int maxRolloutScenarios;									// Maximum number of sampled scenarios per candidate and decision
+	double rolloutTimeBudget;									// Time budget of the rollouts of a decision (in seconds), unlimited if not positive
+	int nbRolloutThreads;										// Number of threads that evaluate the candidates of a decision (0: one per simulation CPU)
+	std::unique_ptr<ThreadPool> rolloutPool;					// Threads that evaluate the candidates, started with the first decision of "rollout"
+	std::string runSeed;										// Seed(s) of the random numbers of the current method, recorded in the results store
+	unsigned rolloutSeed;										// Seed of the rollout scenarios of the episode: its number, or the seed of the replication
+	long nbRolloutDecisions;									// Number of decisions and scenarios per candidate evaluated by the rollout policy
+	long nbRolloutScenarios;
+	double totalRolloutTime;									// Total and maximum time of a rollout decision (in seconds)
+	double maxRolloutTime;
+	EpisodeStorage storage;										// What the next episodes keep: STORE_STATISTICS with --streaming (bounded memory for long horizons), STORE_ALL
+																// otherwise. Training switches to STORE_ORDERS for its episodes and back afterwards
+	EpisodeStorage episodeStorage;								// What the current episode keeps, set when it is initialized and used until it is freed
+	size_t arrivalChunkSize;									// Number of arrivals that are drawn at once in streaming mode
+	size_t arrivalOffset;										// Index of the arrival that is stored first in orderTimes, clientsVector, etc.
+	int arrivalDrawTime;										// Arrival time of the last arrival that has been drawn (rounded to seconds)
+	double arrivalClock;										// Exact arrival time of the last arrival that has been drawn
+	std::vector<double> arrivalTimesBuffer;						// Arrival times of the chunk that is drawn
+	bool allArrivalsDrawn;										// True if the arrivals up to the time limit have been drawn
+	int nbOrdersArrived;										// Number of orders that have arrived in the episode
+	int nbOrdersAccepted;										// Number of orders that have been accepted in the episode
+	long long objValueOfFinishedOrders;							// Waiting times of served orders plus penalties of rejected orders
+	WaitingTimeHistogram waitingTimes;							// Waiting times of the orders served in the episode
+	std::vector<WarehouseStatistics> warehouseStatistics;		// Utilization and queue counters of each warehouse in the episode
+	double targetHalfWidth;										// If positive, evaluations stop once the 95% confidence half-width is below this share of the mean costs
+	int minEpochs;												// Number of epochs of an evaluation before it may stop, and the maximum number of epochs
+	int maxEpochs;
+	bool compareWithBaseline;									// If true, each scenario of an evaluation is also simulated with the nearest warehouse policy
+	RunningEstimate costEstimate;								// Costs of the evaluated policy, and its costs minus those of the baseline on the same scenarios
+	RunningEstimate differenceEstimate;
+	RunningEstimate baselineEstimate;							// Costs of the baseline policy
+	XorShift128 scenarioRng;									// Random number generator at the start of the current scenario
+	torch::Tensor (Environment::*stateKernel)(Order* order);		// State builder for the number of warehouses of the instance, chosen once in the constructor
+	std::unique_ptr<EventLog> eventLog;							// Log the events are recorded to or replayed from (if requested)
+	bool observeEpisode;										// If false, the episode is neither logged nor added to the metrics (baseline runs of --baseline)
+	bool measureDecisionLatency;								// If true, the time of each assignment decision is measured for the metrics (when they are published)
+	std::vector<uint64_t> decisionLatencyCounts;				// Decision latencies of the current episode per bucket of decisionLatencyMetric, and their sum (in seconds)
+	double decisionLatencySum;
+	MetricsCounter* episodesMetric;								// Metrics of the process (see Metrics.h), updated once per episode
+	MetricsCounter* eventsMetric;
+	MetricsCounter* ordersMetric;
+	MetricsCounter* rejectedOrdersMetric;
+	MetricsGauge* episodeCostsMetric;
+	MetricsGauge* rejectionRateMetric;
+	MetricsGauge* averageCostsMetric;
+	MetricsGauge* maxBacklogMetric;
+	MetricsGauge* lossMetric;
+	MetricsHistogram* decisionLatencyMetric;
+	CourierRepositioning repositioning;							// Decides where couriers drive after serving a client
+	std::vector<RepositioningCandidate> repositioningCandidates;	// Candidates of the current repositioning decision
+	std::vector<int> repositioningNearest;						// Other warehouses ordered by travel time from the client of the current decision
+	std::shared_ptr<DecisionCache> decisionCache;				// Actions of the policy net in evaluation by client and quantized load (--decisionCache), null if disabled
+	int decisionCacheQuantum;									// Step of the quantized waiting times of a cache key (in seconds)
+	int decisionCacheVerify;									// Every decisionCacheVerify-th hit also evaluates the policy net (0: never)
+	std::vector<int> decisionKey;								// Cache key of the current decision
+	DecisionCacheStatistics decisionCacheStatistics;			// Decisions of the current evaluation that went through the cache
+	bool trainRepositioning;									// If true, repositioning decisions are sampled and recorded for REINFORCE
+	std::vector<float> repositioningStates;						// Features of the candidates of all recorded decisions of the episode
+	std::vector<int64_t> repositioningActions;					// Chosen candidate, time and chosen warehouse of each recorded decision
+	std::vector<int> repositioningTimes;
+	std::vector<int> repositioningWarehouses;
+	bool mixedPrecision;										// If true, the policy updates run the linear layers in bfloat16 (--mixedPrecision)
+	int nbPolicyWarehouses;										// Warehouses of the input and output layout of the policy net, instances with fewer ones are padded
+	std::vector<std::unique_ptr<Data>> trainingInstances;		// Instances of --trainInstances, loaded once with the first training
+	double trainingUpdateTime;									// Seconds spent in the policy updates of the last training, and its average costs
+	double trainingAverageCosts;								// over the last 100 epochs
+	int episodeCounter;											// Number of episodes that have been initialized
+	std::shared_ptr<policyNetwork> replicationNet;				// Policy net of the replications of testREINFORCE, loaded with the first one
 	torch::Tensor assingmentProblemStates;
 	torch::Tensor assingmentProblemActions;
-
-	// In this method we apply the nearest warehouse policy.
-	void nearestWarehousePolicy(int timelimit);
-	// In these methods we train and test a REINFORCE algorithm
-	void trainREINFORCE(int timelimit, float lambdaTemporal, float lambdaSpatial);
-	void testREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial);
+	torch::Tensor assignmentProblemMasks;						// Outputs each recorded action was sampled from, see getActionMask
+	std::vector<int> assignmentProblemOrders;					// IDs of the orders of the recorded decisions, in the same order
 
 	// In this method we initialize the rest of the Data, such as warehouses, couriers, etc.
 	void initialize(int timeLimit);
 
+	// Function that simulates one episode on the initialized data structures. Each arriving order is assigned to a warehouse by chooseWarehouseForOrder,
+	// or, if batchWindow is positive, buffered and assigned jointly with the other orders of its window by assignBatch
+	void simulateEpisode(int timeLimit, const std::function<void(Order*)>& chooseWarehouseForOrder, int batchWindow = 0);
+
+	// Function that assigns an order, whose warehouse has been chosen, to a picker and (if available) a courier
+	void dispatchOrder(Order* newOrder);
+
+	// Function that jointly assigns the orders of the current batch window to warehouses, pickers and couriers
+	void assignBatch();
+
+	// Function that adds the counters of the episode that just ended to the metrics
+	void updateEpisodeMetrics();
+	// Function that adds the time of an assignment decision (in seconds) to the decision latencies of the episode
+	void addDecisionLatency(double seconds);
+
+	// Function that records an event at the current time if an event log is active
+	void logEvent(EventType type, int order, int warehouse, int agent, int value);
+
+	// Function that draws up to nbArrivals further arrivals (with their clients, comission and service times), but not beyond timeLimit
+	void drawArrivals(int timeLimit, size_t nbArrivals);
+	// Function that makes sure the arrivals after counter are known, dropping the ones that have been consumed in streaming mode
+	void ensureArrivalsDrawn(int timeLimit, size_t counter);
+	// Function that returns the number of arrivals that have been drawn in the episode
+	size_t getNbArrivalsDrawn();
+
 	// Function to initialize the values of an order
 	void initOrder(int currentTime, Order* o);
 
@@ -67,12 +256,32 @@ private:
 	void chooseClosestWarehouseForOrder(Order* newOrder);
 	void choosePickerForOrder(Order* newOrder);
 	void chooseCourierForOrder(Order* newOrder);
+
+	// Function that returns the warehouses that may serve an order (bit w for warehouse w), i.e., the ones whose service zone contains its client
+	uint64_t getServiceZones(Order* order);
 	
+	// Function that assigns order to the warehouse (or rejects it) whose rollouts from the current state have the lowest mean costs
+	void chooseWarehouseForOrderRollout(Order* newOrder, int timeLimit);
+	// Function that returns an index-based copy of the current state of the episode
+	SimulationState snapshot();
+
 	// Function that assigns order to a warehouse with the REINFORCE algorithm
 	void chooseWarehouseForOrderREINFORCE(Order* newOrder, policyNetwork& n, bool train);
-
-	// Function that assigns a courier to the closest warehouse
+	// Function that returns the index of the warehouse the policy net chooses in state for an order with the service zones zones (nbWarehouses to reject)
+	int getActionREINFORCE(torch::Tensor state, policyNetwork& n, uint64_t zones, bool train);
+	// Function that returns a row with 1 for each output of the policy net that getActionREINFORCE may choose for the service zones zones:
+	// the warehouses in the zones (all of them without zones) and rejecting, but not the padding of a padded net
+	torch::Tensor getActionMask(uint64_t zones);
+	// Function that returns the probability of each action renormalized over the outputs of its mask, i.e., the probability it was sampled with
+	static torch::Tensor getMaskedProbabilities(torch::Tensor predictions, torch::Tensor actions, torch::Tensor masks);
+	// Function that writes the decision cache key of an order: its client, the time slot of the travel times and the four counters of each warehouse
+	// of the state, with the waiting times for a picker and a courier rounded up to decisionCacheQuantum seconds
+	void fillDecisionKey(Order* order);
+
+	// Function that sends a courier that served its order to a warehouse (see CourierRepositioning) and counts the order as served
 	void chooseClosestWarehouseForCourier(Courier* courier);
+	// Function that moves a courier that leaves its client at departureTime to the warehouse chosen by the repositioning policy
+	void repositionCourier(Courier* courier, int departureTime);
 
 	// Function that deletes order from ordersNotServed vector
 	void RemoveOrderFromVector(std::vector<Order*> & V, Order* orderToDelete);
@@ -104,18 +313,64 @@ private:
 	// Functions that writes routes/orders and costs to file
 	void writeRoutesAndOrdersToFile(std::string fileNameRoutes, std::string fileNameOrders);
 	void writeCostsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, float lambdaTemporal, float lambdaSpatial, bool is_training);
-	void writeStatsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, float lambdaTemporal, float lambdaSpatial, bool is_training, bool is_nearest_policy);
+	// The epochs and seeds of replications are recorded in the results store, without them the rows are epochs 1, 2, ... of one random number stream
+	void writeStatsToFile(std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, std::vector<std::vector<int>> waitingTimeQuantiles, float lambdaTemporal, float lambdaSpatial, bool is_training, bool is_nearest_policy,
+		const std::vector<int>& epochs = std::vector<int>(), const std::vector<int>& seeds = std::vector<int>());
+	void writeStatsToFile(std::string fileName, std::vector<float> costs, std::vector<float> averageRejectionRateVector, std::vector<float> averageWaitingTime, std::vector<float> maxWaitingTime, std::vector<std::vector<int>> waitingTimeQuantiles,
+		const std::vector<int>& epochs = std::vector<int>(), const std::vector<int>& seeds = std::vector<int>());
+	// Function that returns the metadata of the run for the results store (--resultsStore): the positional arguments, the options, the seed, the time and the process
+	std::map<std::string, std::string> getRunMetadata(const std::string& kind);
+	// Function that formats a lambda for the results store, the same way whether it comes from the command line or from a configuration
+	static std::string formatLambda(double lambda);
+	// Function that returns the name of the kpiData file of a policy, e.g., "NearestWarehousePolicy"
+	std::string getKpiFileName(const std::string& policy);
+	// Function that writes the waiting time quantiles and the utilization and queue counters of each warehouse to file
+	void writeKpisToFile(std::string fileName, const WaitingTimeHistogram& allWaitingTimes, const std::vector<WarehouseStatistics>& allWarehouseStatistics);
+	// Functions of evaluations with adaptive stopping: startEvaluation resets the estimates, startScenario remembers the random numbers of the next
+	// episode, finishScenario adds the costs of the episode (and of the baseline on the same random numbers) and returns false if the evaluation can stop
+	void startEvaluation();
+	void startScenario();
+	bool finishScenario(int timeLimit, int epoch, long long objValue);
+	void reportEvaluation();
+	// Function that returns the 50, 90, 95 and 99 percent quantiles of the waiting times of the last episode
+	std::vector<int> getWaitingTimeQuantiles();
+	// Function that adds the waiting times and warehouse counters of the last episode to the totals, e.g., over all epochs or replications
+	void mergeEpisodeKpis(WaitingTimeHistogram& allWaitingTimes, std::vector<WarehouseStatistics>& allWarehouseStatistics);
 	// Function to draw an inter arrival time based on rate specified in data
 	int drawFromExponentialDistribution(double lambda);
 
 	// Function that returns the objective value (waiting time + penalty)
-	int getObjValue();
-
-
-	// Function that returns the state as a tensor
+	long long getObjValue();
+
+	// Function that trains the policy net with REINFORCE for at most nbEpochs episodes, using the baseline "none", "running" (average costs per nearest warehouse)
+	// or "critic" (value network). Stops once the average costs of 100 episodes reach targetCosts (if positive) and returns that epoch, -1 if never reached
+	int runREINFORCE(int timeLimit, float lambdaTemporal, float lambdaSpatial, const std::string& baseline, int nbEpochs, double targetCosts, std::string netFileName, bool writeResults);
+	// Function that subtracts the baseline from the discounted costs of the last episode, updates the baseline and normalizes the advantages
+	torch::Tensor getAdvantages(torch::Tensor costs, const std::string& baseline, valueNetwork& critic, torch::optim::Adam& optimizerCritic, std::vector<double>& runningBaselines);
+	// Function that simulates one training episode with the policy net and returns its trajectory
+	Trajectory generateTrajectory(int timeLimit, policyNetwork& n, float lambdaTemporal, float lambdaSpatial);
+	// Function that frees the orders, couriers, pickers, routes and warehouses of the last episode
+	void clearEpisode();
+	// Function that reads the instances of --trainInstances (a comma-separated list of files) with the penalty, inter arrival time and options
+	// of this one, and pads the policy net to the largest number of warehouses among them
+	void loadTrainingInstances();
+	// Function that simulates the next episodes on another instance. The random number generator is carried over, so the stream continues
+	void useInstance(Data* instance);
+
+
+	// Function that returns the state as a tensor, padded to nbPolicyWarehouses: the travel times of the real warehouses, zeros, then the
+	// four counters of each real warehouse, zeros
 	torch::Tensor getStateAssignmentProblem(Order* order);
+	// Function that builds the state with the kernels of WarehouseKernels<N> (N = 0 for any number of warehouses)
+	template <int N> torch::Tensor buildStateAssignmentProblem(Order* order);
+	// Functions that choose the state builder of WarehouseKernels<N>, with N = data->nbWarehouses if it is one of the specialized sizes
+	template <int N> void useWarehouseKernels();
+	void selectWarehouseKernels();
 	// Function that returns the costs of each action
 	torch::Tensor getCostsVectorDiscountedAssignmentProblem(float lambdaTemporal, float lambdaSpatial);
+	// Function that returns the costs of each recorded repositioning decision: the costs of the orders that arrive after it, discounted by their
+	// time after the decision and their distance to the chosen warehouse
+	torch::Tensor getCostsVectorDiscountedRepositioningProblem(float lambdaTemporal, float lambdaSpatial);
 };
 
 struct policyNetwork : torch::nn::Module {
@@ -126,24 +381,49 @@ struct policyNetwork : torch::nn::Module {
 		fc4 = register_module("fc4", torch::nn::Linear(256, outputSize));
 	}
 
-	// Implement the Net's algorithm.
-	torch::Tensor forward(torch::Tensor x) {	
+	// Implement the Net's algorithm. With mixedPrecision, the linear layers run in bfloat16 (see linear), the layer norm and the softmax in fp32
+	torch::Tensor forward(torch::Tensor x, bool mixedPrecision = false) {	
 		// Use one of many tensor manipulation functions.
 		x = torch::layer_norm(x, (x.size(1)));
-		x = torch::relu(fc1->forward(x));
+		x = torch::relu(linear(fc1, x, mixedPrecision));
 		// x = torch::layer_norm(x, (x.size(1)));
-		x = torch::relu(fc2->forward(x));
-		x = torch::relu(fc3->forward(x));
-		x = fc4->forward(x);
+		x = torch::relu(linear(fc2, x, mixedPrecision));
+		x = torch::relu(linear(fc3, x, mixedPrecision));
+		x = linear(fc4, x, mixedPrecision).to(torch::kFloat);
 		x = torch::softmax(x, /*dim=*/1);
 		return x;
 	}
 
+	// Function that applies a linear layer, in mixed precision on bfloat16 copies of the input and the fp32 weights. The casts are part of the graph,
+	// so the gradients reach the fp32 weights that Adam updates, and the matrix products accumulate in fp32 internally
+	torch::Tensor linear(torch::nn::Linear& layer, const torch::Tensor& x, bool mixedPrecision) {
+		if (!mixedPrecision) return layer->forward(x);
+		return torch::linear(x.to(torch::kBFloat16), layer->weight.to(torch::kBFloat16), layer->bias.to(torch::kBFloat16));
+	}
+
 	// Use one of many "standard library" modules.
 	torch::nn::Linear fc1{nullptr}, fc2{nullptr}, fc3{nullptr}, fc4{nullptr};
 };
 
 
+// Value network that estimates the discounted costs (divided by the penalty) of the state of an order. Used as baseline of REINFORCE
+struct valueNetwork : torch::nn::Module {
+	valueNetwork(int64_t inputSize) {
+		fc1 = register_module("fc1", torch::nn::Linear(inputSize, 256));
+		fc2 = register_module("fc2", torch::nn::Linear(256, 128));
+		fc3 = register_module("fc3", torch::nn::Linear(128, 1));
+	}
+
+	torch::Tensor forward(torch::Tensor x) {
+		x = torch::layer_norm(x, (x.size(1)));
+		x = torch::relu(fc1->forward(x));
+		x = torch::relu(fc2->forward(x));
+		return fc3->forward(x);
+	}
+
+	torch::nn::Linear fc1{nullptr}, fc2{nullptr}, fc3{nullptr};
+};
+
 struct logLoss : public torch::nn::Module {
 public:
     logLoss() {}
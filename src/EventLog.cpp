@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "EventLog.h"
+
+static const char eventLogMagic[4] = {'O', 'A', 'E', 'L'};
+static const uint32_t eventLogVersion = 1;
+static const size_t eventLogBufferSize = 4096;	// Records per write or read, i.e., 64 KB
+
+static const char* eventTypeName(uint8_t type)
+{
+    switch (type){
+        case EPISODE_START: return "EPISODE_START";
+        case ORDER_ARRIVAL: return "ORDER_ARRIVAL";
+        case ORDER_ASSIGNED: return "ORDER_ASSIGNED";
+        case COURIER_ASSIGNED: return "COURIER_ASSIGNED";
+        case COURIER_ARRIVAL: return "COURIER_ARRIVAL";
+        case TIME_SYNC: return "TIME_SYNC";
+        default: return "UNKNOWN";
+    }
+}
+
+
+EventLog::EventLog(const std::string& fileName, bool replay, const std::string& commandLine) : replay(replay), position(0), filled(0), lastTime(0), nbEvents(0)
+{
+    static_assert(sizeof(EventRecord) == 16, "Event records must be 16 bytes wide");
+    buffer = std::vector<EventRecord>(eventLogBufferSize);
+    file = std::fopen(fileName.c_str(), replay ? "rb" : "wb");
+    if (!file) throw std::runtime_error("Could not open event log " + fileName);
+
+    uint32_t commandLength = commandLine.size();
+    if (!replay){
+        std::fwrite(eventLogMagic, 1, 4, file);
+        std::fwrite(&eventLogVersion, sizeof(uint32_t), 1, file);
+        std::fwrite(&commandLength, sizeof(uint32_t), 1, file);
+        std::fwrite(commandLine.data(), 1, commandLength, file);
+        std::cout << "----- RECORDING EVENTS IN : " << fileName << std::endl;
+    }else{
+        char magic[4];
+        uint32_t version, recordedLength;
+        if (std::fread(magic, 1, 4, file) != 4 || std::memcmp(magic, eventLogMagic, 4) != 0 || std::fread(&version, sizeof(uint32_t), 1, file) != 1 || version != eventLogVersion){
+            throw std::runtime_error("Not an event log (or unsupported version): " + fileName);
+        }
+        if (std::fread(&recordedLength, sizeof(uint32_t), 1, file) != 1) throw std::runtime_error("Truncated event log " + fileName);
+        std::string recordedCommandLine(recordedLength, ' ');
+        if (std::fread(&recordedCommandLine[0], 1, recordedLength, file) != recordedLength) throw std::runtime_error("Truncated event log " + fileName);
+        if (recordedCommandLine != commandLine){
+            std::cout << "----- WARNING: event log was recorded with: " << recordedCommandLine << std::endl;
+        }
+        std::cout << "----- REPLAYING EVENTS OF : " << fileName << std::endl;
+    }
+}
+
+EventLog::~EventLog()
+{
+    if (!replay) flush();
+    std::fclose(file);
+}
+
+void EventLog::flush()
+{
+    std::fwrite(buffer.data(), sizeof(EventRecord), position, file);
+    position = 0;
+}
+
+void EventLog::refill()
+{
+    filled = std::fread(buffer.data(), sizeof(EventRecord), buffer.size(), file);
+    position = 0;
+}
+
+void EventLog::finish()
+{
+    if (!replay) return;
+    if (position == filled) refill();
+    if (position < filled){
+        std::stringstream message;
+        message << "Replay finished after " << nbEvents << " events, but the log contains more events, next: " << eventTypeName(buffer[position].type);
+        throw ReplayDivergence(message.str());
+    }
+    std::cout << "----- Replay matches the event log (" << nbEvents << " events) -----" << std::endl;
+}
+
+void EventLog::reportDivergence(const EventRecord* expected, const EventRecord& actual)
+{
+    std::stringstream message;
+    message << "Replay diverges at event " << nbEvents << ". ";
+    auto describe = [&](const EventRecord& event){
+        message << eventTypeName(event.type) << " (time delta " << event.timeDelta << ", order " << event.order << ", warehouse " << (int)event.warehouse << ", courier " << event.agent << ", value " << event.value << ")";
+    };
+    if (expected){
+        message << "Expected ";
+        describe(*expected);
+        message << ", got ";
+    }else{
+        message << "The log ended, got ";
+    }
+    describe(actual);
+    throw ReplayDivergence(message.str());
+}
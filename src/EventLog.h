@@ -0,0 +1,110 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Types of the events of a simulation
+enum EventType : uint8_t
+{
+	EPISODE_START = 1,			// A new episode starts (order: episode number)
+	ORDER_ARRIVAL = 2,			// An order arrives (order, value: client)
+	ORDER_ASSIGNED = 3,			// An order is assigned to a warehouse (order, warehouse: -1 if rejected)
+	COURIER_ASSIGNED = 4,		// A courier is assigned to an order (order, agent: courier, warehouse, value: arrival time at the client)
+	COURIER_ARRIVAL = 5,		// A courier arrives at an order and is sent to a warehouse (order, agent: courier, warehouse, value: time available there)
+	TIME_SYNC = 6				// The time jumps by more than a delta can hold (value: absolute time)
+};
+
+// Structure of a record of the event log. All records have the same width (16 bytes), times are stored as difference to the previous record
+struct EventRecord
+{
+	uint8_t type;				// Type of the event
+	int8_t warehouse;			// Warehouse of the event (-1 if none)
+	int16_t timeDelta;			// Time of the event minus time of the previous event
+	int32_t order;				// Order of the event (-1 if none)
+	int32_t agent;				// Courier of the event (-1 if none)
+	int32_t value;				// Additional value, depending on the type
+};
+
+// Exception that is thrown when a replayed simulation deviates from the event log
+class ReplayDivergence : public std::runtime_error
+{
+public:
+	ReplayDivergence(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Class that records the events of a simulation to a compact binary file, or replays a simulation against such a file.
+// In replay mode, every event of the simulation is compared with the next record of the file, and the first difference is reported
+class EventLog
+{
+public:
+	// Constructor: opens fileName for recording, or for replaying if replay is true. The command line is stored in (and checked against) the header
+	EventLog(const std::string& fileName, bool replay, const std::string& commandLine);
+
+	// Destructor: writes the records that are still buffered
+	~EventLog();
+
+	// Record an event, or in replay mode compare it with the next record of the file
+	void record(EventType type, int time, int order, int warehouse, int agent, int value)
+	{
+		int timeDelta = time - lastTime;
+		if (timeDelta < INT16_MIN || timeDelta > INT16_MAX)
+		{
+			push({TIME_SYNC, -1, 0, -1, -1, time});
+			timeDelta = 0;
+		}
+		lastTime = time;
+		push({(uint8_t)type, (int8_t)warehouse, (int16_t)timeDelta, order, agent, value});
+	}
+
+	// In replay mode, check that the file does not contain more events than the simulation
+	void finish();
+
+	// Number of events recorded or replayed so far
+	long getNbEvents() const { return nbEvents; }
+
+private:
+	FILE* file;								// File of the log
+	bool replay;							// True if the simulation is checked against the file
+	std::vector<EventRecord> buffer;		// Records that have not been written yet, or that have been read but not compared yet
+	size_t position;						// Next record in the buffer
+	size_t filled;							// Number of valid records in the buffer (replay mode)
+	int lastTime;							// Time of the previous record
+	long nbEvents;							// Number of records so far
+
+	// Append a record to the buffer (recording) or compare it with the next record of the file (replay)
+	void push(const EventRecord& event)
+	{
+		if (!replay)
+		{
+			buffer[position++] = event;
+			if (position == buffer.size()) flush();
+		}
+		else
+		{
+			if (position == filled) refill();
+			if (position == filled) reportDivergence(nullptr, event);
+			const EventRecord& expected = buffer[position++];
+			if (expected.type != event.type || expected.warehouse != event.warehouse || expected.timeDelta != event.timeDelta ||
+				expected.order != event.order || expected.agent != event.agent || expected.value != event.value)
+			{
+				reportDivergence(&expected, event);
+			}
+		}
+		nbEvents++;
+	}
+
+	// Write the buffered records to the file
+	void flush();
+
+	// Read the next records from the file
+	void refill();
+
+	// Throw a ReplayDivergence that describes the expected and the actual event
+	void reportDivergence(const EventRecord* expected, const EventRecord& actual);
+};
+
+#endif
@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BinaryInstance.h"
+
+// Instance builder: creates the same instances as python/createInstance.py, without pandas.
+// The duration CSV is tokenized by several threads, and the instance is written in the text format or directly in the binary format read by Data.
+//
+// Usage: ./instanceBuilder instanceName [--limit=900] [--couriersPerWarehouse=5] [--pickersPerWarehouse=3] [--meanComissionTime=180]
+//        [--meanServiceTimeAtClient=60] [--test] [--binary] [--threads=n] [--durations=data/allDurations15.csv] [--stores=data/getirStores.json]
+// With --test, the clients that are not drawn for the training instance are used (as for instance_test)
+
+// Mersenne Twister of the Python random module, so that the clients drawn by random.sample with the same seed are reproduced exactly
+class PythonRandom
+{
+    uint32_t mt[624];
+    int index;
+
+    // Function that regenerates the 624 words of the state
+    void twist()
+    {
+        for (int i = 0; i < 624; i++)
+        {
+            uint32_t y = (mt[i] & 0x80000000U) | (mt[(i + 1) % 624] & 0x7fffffffU);
+            mt[i] = mt[(i + 397) % 624] ^ (y >> 1) ^ ((y & 1U) ? 0x9908b0dfU : 0U);
+        }
+        index = 0;
+    }
+
+    // Function that returns the next 32 random bits
+    uint32_t next()
+    {
+        if (index >= 624) twist();
+        uint32_t y = mt[index++];
+        y ^= (y >> 11);
+        y ^= (y << 7) & 0x9d2c5680U;
+        y ^= (y << 15) & 0xefc60000U;
+        y ^= (y >> 18);
+        return y;
+    }
+
+public:
+    // Constructor: same state as random.seed(seed) for a non-negative integer seed below 2^32 (init_by_array with one key word)
+    PythonRandom(uint32_t seed)
+    {
+        mt[0] = 19650218U;
+        for (int i = 1; i < 624; i++) mt[i] = 1812433253U * (mt[i - 1] ^ (mt[i - 1] >> 30)) + i;
+        int i = 1;
+        for (int k = 624; k > 0; k--)
+        {
+            mt[i] = (mt[i] ^ ((mt[i - 1] ^ (mt[i - 1] >> 30)) * 1664525U)) + seed;
+            if (++i >= 624) { mt[0] = mt[623]; i = 1; }
+        }
+        for (int k = 623; k > 0; k--)
+        {
+            mt[i] = (mt[i] ^ ((mt[i - 1] ^ (mt[i - 1] >> 30)) * 1566083941U)) - i;
+            if (++i >= 624) { mt[0] = mt[623]; i = 1; }
+        }
+        mt[0] = 0x80000000U;
+        index = 624;
+    }
+
+    // Function that returns a uniform integer in [0, n), as random._randbelow (n below 2^32)
+    int randbelow(int n)
+    {
+        int bits = 0;
+        while ((1LL << bits) <= n) bits++;
+        uint32_t r = next() >> (32 - bits);
+        while ((int64_t)r >= n) r = next() >> (32 - bits);
+        return (int)r;
+    }
+
+    // Function that returns k distinct indices of range(n) in the order of random.sample(range(n), k)
+    std::vector<int> sample(int n, int k)
+    {
+        std::vector<int> result(k);
+        long long setSize = 21;
+        if (k > 5) setSize += (long long)std::pow(4, std::ceil(std::log(3.0 * k) / std::log(4.0)));
+        if (n <= setSize)
+        {
+            std::vector<int> pool(n);
+            for (int i = 0; i < n; i++) pool[i] = i;
+            for (int i = 0; i < k; i++)
+            {
+                int j = randbelow(n - i);
+                result[i] = pool[j];
+                pool[j] = pool[n - i - 1];
+            }
+        }
+        else
+        {
+            std::set<int> selected;
+            for (int i = 0; i < k; i++)
+            {
+                int j = randbelow(n);
+                while (selected.count(j)) j = randbelow(n);
+                selected.insert(j);
+                result[i] = j;
+            }
+        }
+        return result;
+    }
+};
+
+// Function that formats a double with the fewest digits that read back to the same value, as Python prints floats
+static std::string formatDouble(double value)
+{
+    char buffer[32];
+    for (int precision = 1; precision <= 17; precision++)
+    {
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (std::strtod(buffer, nullptr) == value) break;
+    }
+    std::string text(buffer);
+    if (text.find_first_of(".en") == std::string::npos) text += ".0";
+    return text;
+}
+
+// Function that parses a decimal number like the default float parser of pandas.read_csv, so that the written coordinates are the same as the ones
+// of the python preprocessing: at most 17 digits are accumulated in a double that is then scaled by one power of ten. Sets end after the number
+static double parseDouble(const char* text, const char** end)
+{
+    // Correctly rounded powers of ten, initialized once (thread-safe, the parser runs in several threads)
+    static const std::vector<double> powersOfTen = []()
+    {
+        std::vector<double> powers;
+        for (int e = 0; e <= 308; e++) powers.push_back(std::strtod(("1e" + std::to_string(e)).c_str(), nullptr));
+        return powers;
+    }();
+    const int maxDigits = 17;
+    const char* p = text;
+    while (*p == ' ') p++;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    double number = 0.0;
+    int exponent = 0;
+    int nbDigits = 0;
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        if (nbDigits < maxDigits) { number = number * 10.0 + (*p - '0'); nbDigits++; }
+        else exponent++;
+    }
+    if (*p == '.')
+    {
+        p++;
+        for (; nbDigits < maxDigits && *p >= '0' && *p <= '9'; p++) { number = number * 10.0 + (*p - '0'); nbDigits++; exponent--; }
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (nbDigits == 0) { *end = text; return 0.0; }
+    if (negative) number = -number;
+    if (*p == 'e' || *p == 'E')
+    {
+        const char* q = p + 1;
+        bool negativeExponent = (*q == '-');
+        if (*q == '-' || *q == '+') q++;
+        if (*q >= '0' && *q <= '9')
+        {
+            int value = 0;
+            while (*q >= '0' && *q <= '9') { value = std::min(value * 10 + (*q - '0'), 10000); q++; }
+            exponent += negativeExponent ? -value : value;
+            p = q;
+        }
+    }
+    *end = p;
+    if (exponent > 308) return negative ? -HUGE_VAL : HUGE_VAL;
+    if (exponent >= 0) return number * powersOfTen[exponent];
+    if (exponent >= -308) return number / powersOfTen[-exponent];
+    if (exponent < -616) return 0.0;
+    return number / powersOfTen[-308 - exponent] / powersOfTen[308];
+}
+
+// Function that parses the lines in [begin, end) of a CSV file into a flat vector of values and returns the number of values per line
+static int tokenizeLines(const char* begin, const char* end, std::vector<double>& values)
+{
+    int nbColumns = -1;
+    const char* line = begin;
+    while (line < end)
+    {
+        const char* lineEnd = std::find(line, end, '\n');
+        int columns = 0;
+        const char* field = line;
+        while (field < lineEnd)
+        {
+            const char* fieldEnd;
+            values.push_back(parseDouble(field, &fieldEnd));
+            columns++;
+            field = std::find(fieldEnd, lineEnd, ',');
+            if (field < lineEnd) field++;
+        }
+        if (columns > 0)
+        {
+            if (nbColumns != -1 && columns != nbColumns) throw std::runtime_error("Lines of the duration file have different numbers of columns");
+            nbColumns = columns;
+        }
+        line = lineEnd + 1;
+    }
+    return nbColumns;
+}
+
+// Function that reads a CSV file with a header line, splitting the lines between nbThreads threads. Returns the rows as a flat vector
+static std::vector<double> readCSV(const std::string& fileName, int nbThreads, int& nbColumns)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open " + fileName);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const char* begin = content.data() + content.find('\n') + 1;
+    const char* end = content.data() + content.size();
+
+    // Each thread gets a range of about the same size that starts after a line break
+    std::vector<const char*> bounds(1, begin);
+    for (int t = 1; t < nbThreads; t++)
+    {
+        const char* bound = std::max(bounds.back(), begin + (end - begin) * t / nbThreads);
+        bound = std::min(end, std::find(bound, end, '\n') + 1);
+        bounds.push_back(bound);
+    }
+    bounds.push_back(end);
+
+    std::vector<std::vector<double>> values(nbThreads);
+    std::vector<int> columns(nbThreads, -1);
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(nbThreads);
+    for (int t = 0; t < nbThreads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            try { columns[t] = tokenizeLines(bounds[t], bounds[t + 1], values[t]); }
+            catch (const std::exception& e) { errors[t] = e.what(); }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::vector<double> rows;
+    nbColumns = -1;
+    for (int t = 0; t < nbThreads; t++)
+    {
+        if (!errors[t].empty()) throw std::runtime_error(errors[t]);
+        if (columns[t] == -1) continue;
+        if (nbColumns != -1 && columns[t] != nbColumns) throw std::runtime_error("Lines of the duration file have different numbers of columns");
+        nbColumns = columns[t];
+        rows.insert(rows.end(), values[t].begin(), values[t].end());
+    }
+    return rows;
+}
+
+// Function that reads the longitude and latitude of each store of a JSON object of the form {"name": {"latitude": x, "longitude": y}, ...}
+static std::vector<std::pair<double, double>> readStores(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file) throw std::runtime_error("Could not open " + fileName);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<std::pair<double, double>> stores;
+    std::map<std::string, double> fields;
+    int depth = 0;
+    for (size_t i = 0; i < content.size(); i++)
+    {
+        char c = content[i];
+        if (c == '{') depth++;
+        else if (c == '}')
+        {
+            if (depth == 2)
+            {
+                if (!fields.count("longitude") || !fields.count("latitude")) throw std::runtime_error("Store without longitude or latitude in " + fileName);
+                stores.push_back(std::make_pair(fields["longitude"], fields["latitude"]));
+                fields.clear();
+            }
+            depth--;
+        }
+        else if (c == '"')
+        {
+            size_t close = content.find('"', i + 1);
+            std::string key = content.substr(i + 1, close - i - 1);
+            i = close;
+            if (depth == 2)
+            {
+                size_t colon = content.find(':', i);
+                char* numberEnd;
+                fields[key] = std::strtod(content.c_str() + colon + 1, &numberEnd);
+                i = numberEnd - content.c_str() - 1;
+            }
+        }
+    }
+    return stores;
+}
+
+int main(int argc, char* argv[])
+{
+    std::map<std::string, std::string> options;
+    std::string instanceName;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument(argv[i]);
+        if (argument.compare(0, 2, "--") == 0)
+        {
+            size_t separator = argument.find('=');
+            options[argument.substr(2, separator == std::string::npos ? std::string::npos : separator - 2)] = separator == std::string::npos ? "1" : argument.substr(separator + 1);
+        }
+        else instanceName = argument;
+    }
+    if (instanceName.empty())
+    {
+        std::cout << "Usage: ./instanceBuilder instanceName [--limit=900] [--couriersPerWarehouse=5] [--pickersPerWarehouse=3] [--meanComissionTime=180] [--meanServiceTimeAtClient=60] [--test] [--binary] [--threads=n]" << std::endl;
+        return 1;
+    }
+    auto option = [&](const std::string& name, const std::string& defaultValue) { return options.count(name) ? options[name] : defaultValue; };
+    int limit = std::stoi(option("limit", "900"));
+    int couriersPerWarehouse = std::stoi(option("couriersPerWarehouse", "5"));
+    int pickersPerWarehouse = std::stoi(option("pickersPerWarehouse", "3"));
+    int meanComissionTime = std::stoi(option("meanComissionTime", "180"));
+    int meanServiceTimeAtClient = std::stoi(option("meanServiceTimeAtClient", "60"));
+    int nbThreads = std::stoi(option("threads", std::to_string(std::max(1U, std::thread::hardware_concurrency()))));
+    bool binary = options.count("binary") > 0;
+
+    // Each row of the duration file is a client: index, longitude, latitude and the travel times to the stores
+    auto startTime = std::chrono::steady_clock::now();
+    int nbColumns;
+    std::vector<double> durations = readCSV(option("durations", "data/allDurations15.csv"), nbThreads, nbColumns);
+    int nbRows = durations.size() / nbColumns;
+    int nbWarehouses = nbColumns - 3;
+    std::vector<std::pair<double, double>> stores = readStores(option("stores", "data/getirStores.json"));
+    if ((int)stores.size() != nbWarehouses) throw std::runtime_error("The number of stores does not match the duration file");
+
+    // The training instance contains 75% of the rows (in the order they are drawn), the test instance the others (in file order)
+    PythonRandom random(422);
+    std::vector<int> rows = random.sample(nbRows, (int)std::nearbyint(nbRows * 0.75));
+    if (options.count("test"))
+    {
+        std::vector<bool> drawn(nbRows, false);
+        for (int row : rows) drawn[row] = true;
+        rows.clear();
+        for (int row = 0; row < nbRows; row++)
+        {
+            if (!drawn[row]) rows.push_back(row);
+        }
+    }
+    // Clients whose nearest store is further away than limit are removed
+    std::vector<int> clients;
+    for (int row : rows)
+    {
+        int nearest = INT32_MAX;
+        for (int w = 0; w < nbWarehouses; w++) nearest = std::min(nearest, (int)durations[(size_t)row * nbColumns + 3 + w]);
+        if (nearest <= limit) clients.push_back(row);
+    }
+
+    std::string fileName = "instances/" + instanceName + (binary ? ".bin" : ".txt");
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file) throw std::runtime_error("Could not open " + fileName);
+    if (binary)
+    {
+        uint32_t nameLength = instanceName.size();
+        int32_t nbClients = clients.size(), nbWarehousesOut = nbWarehouses;
+        double meanTimes[2] = {(double)meanComissionTime, (double)meanServiceTimeAtClient};
+        file.write(binaryInstanceMagic, 4);
+        file.write((const char*)&binaryInstanceVersion, sizeof(uint32_t));
+        file.write((const char*)&nameLength, sizeof(uint32_t));
+        file.write(instanceName.data(), nameLength);
+        file.write((const char*)&nbClients, sizeof(int32_t));
+        file.write((const char*)&nbWarehousesOut, sizeof(int32_t));
+        file.write((const char*)meanTimes, sizeof(meanTimes));
+        for (int w = 0; w < nbWarehouses; w++)
+        {
+            int32_t counts[2] = {couriersPerWarehouse, pickersPerWarehouse};
+            file.write((const char*)&w, sizeof(int32_t));
+            file.write((const char*)&stores[w].first, sizeof(double));
+            file.write((const char*)&stores[w].second, sizeof(double));
+            file.write((const char*)counts, sizeof(counts));
+        }
+        for (int32_t c = 0; c < nbClients; c++)
+        {
+            file.write((const char*)&c, sizeof(int32_t));
+            file.write((const char*)&durations[(size_t)clients[c] * nbColumns + 1], 2 * sizeof(double));
+        }
+        std::vector<int32_t> travelTimes;
+        for (int row : clients)
+        {
+            for (int w = 0; w < nbWarehouses; w++) travelTimes.push_back((int32_t)durations[(size_t)row * nbColumns + 3 + w]);
+        }
+        file.write((const char*)travelTimes.data(), travelTimes.size() * sizeof(int32_t));
+    }
+    else
+    {
+        // Same text as python/createInstance.py
+        std::ostringstream text;
+        text << "NAME : " << instanceName << "\n";
+        text << "NUMBER_CLIENTS : " << clients.size() << "\n";
+        text << "NUMBER_WAREHOUSES : " << nbWarehouses << "\n";
+        text << "MEAN_COMMISSION_TIME : " << meanComissionTime << "\n";
+        text << "MEAN_SERVICE_AT_CLIENT_TIME : " << meanServiceTimeAtClient << "\n";
+        text << "WAREHOUSE_SECTION\n";
+        for (int w = 0; w < nbWarehouses; w++)
+        {
+            text << w << "\t" << formatDouble(stores[w].first) << "\t" << formatDouble(stores[w].second) << "\t" << couriersPerWarehouse << "\t" << pickersPerWarehouse << "\n";
+        }
+        text << "CLIENT_SECTION\n";
+        for (size_t c = 0; c < clients.size(); c++)
+        {
+            text << c << "\t" << formatDouble(durations[(size_t)clients[c] * nbColumns + 1]) << "\t" << formatDouble(durations[(size_t)clients[c] * nbColumns + 2]) << "\n";
+        }
+        text << "EDGE_WEIGHT_SECTION\n";
+        for (int row : clients)
+        {
+            for (int w = 0; w < nbWarehouses; w++)
+            {
+                text << (w > 0 ? "\t" : "") << (int)durations[(size_t)row * nbColumns + 3 + w];
+            }
+            text << "\n";
+        }
+        text << "EOF\n";
+        file << text.str();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "----- Instance with " << clients.size() << " Clients, " << nbWarehouses << " Warehouses written to " << fileName << " in " << seconds << " seconds -----" << std::endl;
+    return 0;
+}
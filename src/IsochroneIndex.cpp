@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+
+#include "IsochroneIndex.h"
+
+
+IsochroneIndex::IsochroneIndex() : seconds(0), gridSize(0), minLon(0.0), minLat(0.0), cellWidth(1.0), cellHeight(1.0)
+{
+}
+
+std::vector<std::vector<std::pair<double, double>>> IsochroneIndex::readGeoJsonRings(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file) throw std::runtime_error("Could not open isochrone file " + fileName);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string content = buffer.str();
+    size_t position = content.find("\"coordinates\"");
+    if (position == std::string::npos) throw std::runtime_error("No coordinates in isochrone file " + fileName);
+    position = content.find('[', position);
+
+    // Arrays of numbers are points, an array that directly contains points is a ring. Deeper nesting (polygons of a MultiPolygon) only adds levels
+    std::vector<std::vector<std::pair<double, double>>> rings;
+    std::vector<std::pair<double, double>> ring;
+    int depth = 0;
+    while (position < content.size())
+    {
+        char c = content[position];
+        if (c == '[')
+        {
+            size_t next = content.find_first_not_of(" \t\r\n", position + 1);
+            if (next != std::string::npos && (std::isdigit((unsigned char)content[next]) || content[next] == '-' || content[next] == '+' || content[next] == '.'))
+            {
+                char* end;
+                double lon = std::strtod(content.c_str() + next, &end);
+                end = (char*)std::strchr(end, ',');
+                if (end == nullptr) throw std::runtime_error("Could not parse a point of isochrone file " + fileName);
+                double lat = std::strtod(end + 1, &end);
+                ring.push_back(std::make_pair(lon, lat));
+                // Further values of the point (e.g., the altitude) are skipped
+                position = content.find(']', end - content.c_str());
+                if (position == std::string::npos) break;
+            }
+            else depth++;
+        }
+        else if (c == ']')
+        {
+            depth--;
+            if (!ring.empty())
+            {
+                rings.push_back(ring);
+                ring.clear();
+            }
+            if (depth == 0) break;
+        }
+        position++;
+    }
+    if (rings.empty()) throw std::runtime_error("No polygon in isochrone file " + fileName);
+    return rings;
+}
+
+void IsochroneIndex::load(const std::string& directory, int seconds, int nbWarehouses, int gridSize)
+{
+    this->seconds = seconds;
+    zoneEdges.clear();
+    for (int w = 0; w < nbWarehouses; w++)
+    {
+        addZone(w, readGeoJsonRings(directory + "/isochroneWarehouse_" + std::to_string(seconds) + "s_" + std::to_string(w) + ".json"));
+    }
+    build(gridSize);
+}
+
+void IsochroneIndex::addZone(int warehouse, const std::vector<std::vector<std::pair<double, double>>>& rings)
+{
+    if (warehouse >= 64) throw std::invalid_argument("The isochrone index supports at most 64 warehouses");
+    if ((int)zoneEdges.size() <= warehouse) zoneEdges.resize(warehouse + 1);
+    for (const std::vector<std::pair<double, double>>& ring : rings)
+    {
+        for (size_t i = 0; i < ring.size(); i++)
+        {
+            // Rings are closed, whether or not the last point repeats the first one
+            const std::pair<double, double>& from = ring[i];
+            const std::pair<double, double>& to = ring[(i + 1) % ring.size()];
+            if (from != to) zoneEdges[warehouse].push_back(Edge{from.first, from.second, to.first, to.second});
+        }
+    }
+}
+
+bool IsochroneIndex::crosses(const Edge& edge, double px, double py, double qx, double qy)
+{
+    // The end points of the edge have to be on different sides of the line through the segment (a point on the line counts as below),
+    // and the end points of the segment on different sides of the line through the edge
+    double sideA = (qx - px) * (edge.y1 - py) - (qy - py) * (edge.x1 - px);
+    double sideB = (qx - px) * (edge.y2 - py) - (qy - py) * (edge.x2 - px);
+    if ((sideA > 0) == (sideB > 0)) return false;
+    double sideP = (edge.x2 - edge.x1) * (py - edge.y1) - (edge.y2 - edge.y1) * (px - edge.x1);
+    double sideQ = (edge.x2 - edge.x1) * (qy - edge.y1) - (edge.y2 - edge.y1) * (qx - edge.x1);
+    return (sideP > 0) != (sideQ > 0);
+}
+
+bool IsochroneIndex::zoneContains(int warehouse, double lon, double lat) const
+{
+    // Crossing number of a ray to the east
+    bool inside = false;
+    for (const Edge& edge : zoneEdges[warehouse])
+    {
+        if ((edge.y1 > lat) != (edge.y2 > lat) && lon < edge.x1 + (lat - edge.y1) * (edge.x2 - edge.x1) / (edge.y2 - edge.y1))
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void IsochroneIndex::build(int gridSize)
+{
+    this->gridSize = gridSize;
+    double maxLon = -std::numeric_limits<double>::infinity(), maxLat = -std::numeric_limits<double>::infinity();
+    minLon = std::numeric_limits<double>::infinity();
+    minLat = std::numeric_limits<double>::infinity();
+    for (const std::vector<Edge>& edges : zoneEdges)
+    {
+        for (const Edge& edge : edges)
+        {
+            minLon = std::min(minLon, std::min(edge.x1, edge.x2));
+            maxLon = std::max(maxLon, std::max(edge.x1, edge.x2));
+            minLat = std::min(minLat, std::min(edge.y1, edge.y2));
+            maxLat = std::max(maxLat, std::max(edge.y1, edge.y2));
+        }
+    }
+    if (minLon > maxLon) throw std::invalid_argument("The isochrone index has no zones");
+    cellWidth = std::max(maxLon - minLon, 1e-9) / gridSize * (1.0 + 1e-9);
+    cellHeight = std::max(maxLat - minLat, 1e-9) / gridSize * (1.0 + 1e-9);
+
+    // Each edge goes to the buckets of all cells its bounding box overlaps (a superset of the cells it crosses, which is harmless)
+    const int nbCells = gridSize * gridSize;
+    std::vector<std::vector<std::vector<int>>> buckets(zoneEdges.size());
+    for (size_t z = 0; z < zoneEdges.size(); z++)
+    {
+        buckets[z].resize(nbCells);
+        for (size_t e = 0; e < zoneEdges[z].size(); e++)
+        {
+            const Edge& edge = zoneEdges[z][e];
+            int x0 = (int)((std::min(edge.x1, edge.x2) - minLon) / cellWidth), x1 = (int)((std::max(edge.x1, edge.x2) - minLon) / cellWidth);
+            int y0 = (int)((std::min(edge.y1, edge.y2) - minLat) / cellHeight), y1 = (int)((std::max(edge.y1, edge.y2) - minLat) / cellHeight);
+            for (int y = std::max(0, y0); y <= std::min(gridSize - 1, y1); y++)
+            {
+                for (int x = std::max(0, x0); x <= std::min(gridSize - 1, x1); x++)
+                {
+                    buckets[z][y * gridSize + x].push_back(e);
+                }
+            }
+        }
+    }
+
+    insideMask = std::vector<uint64_t>(nbCells, 0);
+    cellStart = std::vector<int>(nbCells + 1, 0);
+    cellZones.clear();
+    cellEdges.clear();
+    for (int cell = 0; cell < nbCells; cell++)
+    {
+        cellStart[cell] = cellZones.size();
+        double centerLon = minLon + (cell % gridSize + 0.5) * cellWidth;
+        double centerLat = minLat + (cell / gridSize + 0.5) * cellHeight;
+        for (size_t z = 0; z < zoneEdges.size(); z++)
+        {
+            bool centerInside = zoneContains(z, centerLon, centerLat);
+            if (buckets[z][cell].empty())
+            {
+                if (centerInside) insideMask[cell] |= (uint64_t)1 << z;
+                continue;
+            }
+            cellZones.push_back(CellZone{(int)z, centerInside, (int)cellEdges.size(), (int)buckets[z][cell].size()});
+            for (int e : buckets[z][cell])
+            {
+                cellEdges.push_back(zoneEdges[z][e]);
+            }
+        }
+    }
+    cellStart[nbCells] = cellZones.size();
+}
+
+uint64_t IsochroneIndex::zonesContaining(double lon, double lat) const
+{
+    if (gridSize == 0) return 0;
+    double x = (lon - minLon) / cellWidth, y = (lat - minLat) / cellHeight;
+    if (x < 0 || y < 0 || x >= gridSize || y >= gridSize) return 0;
+    int cell = (int)y * gridSize + (int)x;
+    uint64_t zones = insideMask[cell];
+    double centerLon = minLon + ((int)x + 0.5) * cellWidth;
+    double centerLat = minLat + ((int)y + 0.5) * cellHeight;
+    for (int entry = cellStart[cell]; entry < cellStart[cell + 1]; entry++)
+    {
+        const CellZone& cellZone = cellZones[entry];
+        bool inside = cellZone.centerInside;
+        for (int e = cellZone.firstEdge; e < cellZone.firstEdge + cellZone.nbEdges; e++)
+        {
+            if (crosses(cellEdges[e], lon, lat, centerLon, centerLat)) inside = !inside;
+        }
+        if (inside) zones |= (uint64_t)1 << cellZone.warehouse;
+    }
+    return zones;
+}
@@ -0,0 +1,70 @@
+#ifndef ISOCHRONEINDEX_H
+#define ISOCHRONEINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Spatial index of the service zones (isochrone polygons) of the warehouses, which answers which zones contain a point in near-constant time.
+// A uniform grid covers the bounding box of all zones. For each cell, a bit mask holds the zones that contain the whole cell, and the zones
+// whose boundary crosses the cell are listed with the edges in the cell (edge buckets) and whether the center of the cell is inside.
+// For such a zone, a point of the cell is inside if the center is, unless the segment from the point to the center crosses the boundary
+// an odd number of times, and this segment only meets edges of the cell. Zones are at most 64 (one bit per warehouse)
+class IsochroneIndex
+{
+public:
+	// Constructor: empty index
+	IsochroneIndex();
+
+	// Load the zone of each warehouse for a travel time of seconds from directory/isochroneWarehouse_<seconds>s_<warehouse>.json (GeoJSON) and build the index
+	void load(const std::string& directory, int seconds, int nbWarehouses, int gridSize = 128);
+
+	// Add the zone of a warehouse given by its rings of (longitude, latitude) points (even-odd rule, so holes are allowed). build has to be called afterwards
+	void addZone(int warehouse, const std::vector<std::vector<std::pair<double, double>>>& rings);
+
+	// Build the grid with gridSize x gridSize cells
+	void build(int gridSize);
+
+	// Bit w of the result is set if the zone of warehouse w contains the point
+	uint64_t zonesContaining(double lon, double lat) const;
+
+	// Exact test against all edges of a zone (without the grid), e.g., to check the index
+	bool zoneContains(int warehouse, double lon, double lat) const;
+
+	// Travel time of the zones (in seconds) and number of zones
+	int getSeconds() const { return seconds; }
+	int getNbZones() const { return (int)zoneEdges.size(); }
+
+private:
+	struct Edge
+	{
+		double x1, y1, x2, y2;			// End points (longitude, latitude)
+	};
+
+	struct CellZone
+	{
+		int warehouse;					// Zone whose boundary crosses the cell
+		bool centerInside;				// True if the center of the cell is inside the zone
+		int firstEdge;					// Edges of the zone in the cell: cellEdges[firstEdge, firstEdge + nbEdges)
+		int nbEdges;
+	};
+
+	int seconds;								// Travel time of the zones (in seconds)
+	int gridSize;								// Number of cells per dimension
+	double minLon, minLat;						// Lower left corner of the grid
+	double cellWidth, cellHeight;				// Size of a cell
+	std::vector<std::vector<Edge>> zoneEdges;	// All edges of each zone
+	std::vector<uint64_t> insideMask;			// Zones that contain each whole cell
+	std::vector<int> cellStart;					// First entry of each cell in cellZones (compressed sparse row layout), cellStart[nbCells] is the number of entries
+	std::vector<CellZone> cellZones;			// Zones whose boundary crosses a cell
+	std::vector<Edge> cellEdges;				// Edge buckets of the entries of cellZones
+
+	// Function that returns true if the segment from (px, py) to (qx, qy) crosses the edge. Vertices on the segment count for one of their edges only
+	static bool crosses(const Edge& edge, double px, double py, double qx, double qy);
+
+	// Function that reads the rings of the Polygon or MultiPolygon of a GeoJSON file
+	static std::vector<std::vector<std::pair<double, double>>> readGeoJsonRings(const std::string& fileName);
+};
+
+#endif
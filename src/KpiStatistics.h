@@ -0,0 +1,190 @@
+#ifndef KPISTATISTICS_H
+#define KPISTATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Implementation of a log-linear histogram of waiting times (in seconds) in the style of an HDR histogram
+// Values below 128 have their own bucket, larger values are grouped into 64 buckets per power of two, so each bucket is narrower than 1/64 of its values.
+// Adding a value is a few integer operations without allocation, quantiles are read with one pass over the (fixed number of) buckets,
+// and two histograms, e.g., of parallel replications, are merged by adding their counts. The counts are stored inline, so a histogram is plain
+// data that can be copied into the shared memory of the replication workers
+class WaitingTimeHistogram
+{
+    static const int linearBuckets = 128;       // Values below this have their own bucket
+    static const int subBuckets = 64;           // Buckets per power of two above linearBuckets
+    static const int nbBuckets = linearBuckets + 24 * subBuckets;   // Enough for all positive int values
+
+    uint64_t counts_[nbBuckets];    // Number of values in each bucket
+    uint64_t count_;                // Number of values
+    long long sum_;                 // Sum of the values
+    int max_;                       // Largest value
+
+    // Function that returns the bucket of a value
+    static int bucketOf(int value)
+    {
+        if (value < linearBuckets) return std::max(value, 0);
+        int highestBit = 31 - __builtin_clz((unsigned)value);
+        int shift = highestBit - 6;
+        return linearBuckets + (shift - 1) * subBuckets + ((value >> shift) - subBuckets);
+    }
+
+    // Function that returns the middle of the values of a bucket
+    static int valueOf(int bucket)
+    {
+        if (bucket < linearBuckets) return bucket;
+        int shift = (bucket - linearBuckets) / subBuckets + 1;
+        long long lowest = (long long)((bucket - linearBuckets) % subBuckets + subBuckets) << shift;
+        return (int)(lowest + ((1LL << shift) - 1) / 2);
+    }
+
+public:
+    // Constructor: empty histogram
+    WaitingTimeHistogram() : counts_(), count_(0), sum_(0), max_(0)
+    {}
+
+    // Remove all values
+    void clear()
+    {
+        std::fill(counts_, counts_ + nbBuckets, 0);
+        count_ = 0;
+        sum_ = 0;
+        max_ = 0;
+    }
+
+    // Add a value (negative values count as 0)
+    void add(int value)
+    {
+        counts_[bucketOf(value)]++;
+        count_++;
+        sum_ += std::max(value, 0);
+        max_ = std::max(max_, value);
+    }
+
+    // Add the values of another histogram
+    void merge(const WaitingTimeHistogram& other)
+    {
+        for (int b = 0; b < nbBuckets; b++) counts_[b] += other.counts_[b];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    // Get the q-quantile (0 < q <= 1), exact below 128 seconds and within 1/128 of the value above. Returns 0 if the histogram is empty
+    int quantile(double q) const
+    {
+        if (count_ == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * count_ + 0.999999));
+        uint64_t cumulative = 0;
+        for (int b = 0; b < nbBuckets; b++)
+        {
+            cumulative += counts_[b];
+            if (cumulative >= rank) return std::min(valueOf(b), max_);
+        }
+        return max_;
+    }
+
+    // Number of values
+    uint64_t count() const { return count_; }
+
+    // Mean of the values (0 if the histogram is empty)
+    double mean() const { return count_ == 0 ? 0.0 : (double)sum_ / count_; }
+
+    // Largest value
+    int max() const { return max_; }
+};
+
+// Counters of a warehouse over one or several episodes. All counters are sums, so the counters of parallel replications are merged by adding them
+struct WarehouseStatistics
+{
+    long long nbOrdersAccepted;     // Orders assigned to the warehouse
+    long long nbOrdersServed;       // Orders of the warehouse that have been delivered
+    long long courierBusyTime;      // Time couriers of the warehouse spent on trips (to the client and at the door, and the trips back to it)
+    long long courierTime;          // Time couriers counted for the warehouse in total (a repositioned courier counts for his new warehouse from the client on)
+    long long pickerBusyTime;       // Time pickers of the warehouse spent comissioning orders
+    long long pickerTime;           // Time pickers of the warehouse were available in total
+    long long queueLengthTime;      // Integral of the number of orders waiting for a courier over time
+    long long observedTime;         // Length of the episodes
+    int maxQueueLength;             // Highest number of orders waiting for a courier
+    int lastQueueLength;            // Queue length and time of its last change in the current episode
+    int lastQueueChange;
+
+    WarehouseStatistics() : nbOrdersAccepted(0), nbOrdersServed(0), courierBusyTime(0), courierTime(0), pickerBusyTime(0), pickerTime(0),
+        queueLengthTime(0), observedTime(0), maxQueueLength(0), lastQueueLength(0), lastQueueChange(0)
+    {}
+
+    // Record that the number of orders waiting for a courier is queueLength from time on
+    void observeQueueLength(int time, int queueLength)
+    {
+        queueLengthTime += (long long)lastQueueLength * (time - lastQueueChange);
+        lastQueueLength = queueLength;
+        lastQueueChange = time;
+        maxQueueLength = std::max(maxQueueLength, queueLength);
+    }
+
+    // Record that a courier counted for the warehouse from time from to time to
+    void addCourierTime(int from, int to)
+    {
+        courierTime += to - from;
+    }
+
+    // Close the episode at endTime for a warehouse with the given number of pickers. The couriers are added with addCourierTime
+    void finishEpisode(int endTime, int nbPickers)
+    {
+        observeQueueLength(endTime, 0);
+        observedTime += endTime;
+        pickerTime += (long long)nbPickers * endTime;
+        lastQueueChange = 0;
+    }
+
+    // Add the counters of another warehouse, or of the same warehouse in another replication
+    void merge(const WarehouseStatistics& other)
+    {
+        nbOrdersAccepted += other.nbOrdersAccepted;
+        nbOrdersServed += other.nbOrdersServed;
+        courierBusyTime += other.courierBusyTime;
+        courierTime += other.courierTime;
+        pickerBusyTime += other.pickerBusyTime;
+        pickerTime += other.pickerTime;
+        queueLengthTime += other.queueLengthTime;
+        observedTime += other.observedTime;
+        maxQueueLength = std::max(maxQueueLength, other.maxQueueLength);
+    }
+
+    // Share of the courier and picker time spent working
+    double courierUtilization() const { return courierTime == 0 ? 0.0 : (double)courierBusyTime / courierTime; }
+    double pickerUtilization() const { return pickerTime == 0 ? 0.0 : (double)pickerBusyTime / pickerTime; }
+
+    // Time-average number of orders waiting for a courier
+    double meanQueueLength() const { return observedTime == 0 ? 0.0 : (double)queueLengthTime / observedTime; }
+};
+
+// Running mean and variance of independent replications (Welford's algorithm), e.g., of the costs of the simulated episodes
+struct RunningEstimate
+{
+    long count;         // Number of replications
+    double mean;        // Mean of the replications
+    double m2;          // Sum of squared differences to the mean
+
+    RunningEstimate() : count(0), mean(0.0), m2(0.0)
+    {}
+
+    // Add a replication
+    void add(double value)
+    {
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    // Sample variance of the replications
+    double variance() const { return count < 2 ? 0.0 : m2 / (count - 1); }
+
+    // Half-width of the 95% confidence interval of the mean (normal approximation)
+    double halfWidth() const { return count < 2 ? 0.0 : 1.96 * std::sqrt(variance() / count); }
+};
+
+#endif
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "Metrics.h"
+
+
+MetricsHistogram::MetricsHistogram(const std::vector<double>& bounds) : bounds(bounds), counts(new std::atomic<uint64_t>[bounds.size() + 1]), sum(0.0)
+{
+    if (!std::is_sorted(bounds.begin(), bounds.end())) throw std::invalid_argument("Bucket bounds of a histogram must be increasing");
+    for (size_t b = 0; b <= bounds.size(); b++)
+    {
+        counts[b].store(0, std::memory_order_relaxed);
+    }
+}
+
+int MetricsHistogram::bucketOf(double value) const
+{
+    return std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+}
+
+void MetricsHistogram::observe(double value)
+{
+    counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    double expected = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed)) {}
+}
+
+void MetricsHistogram::merge(const std::vector<uint64_t>& bucketCounts, double valueSum)
+{
+    for (size_t b = 0; b < bucketCounts.size() && b <= bounds.size(); b++)
+    {
+        if (bucketCounts[b] > 0) counts[b].fetch_add(bucketCounts[b], std::memory_order_relaxed);
+    }
+    double expected = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(expected, expected + valueSum, std::memory_order_relaxed)) {}
+}
+
+void MetricsHistogram::read(std::vector<uint64_t>& cumulativeCounts, uint64_t& count, double& valueSum) const
+{
+    cumulativeCounts.assign(bounds.size() + 1, 0);
+    count = 0;
+    for (size_t b = 0; b <= bounds.size(); b++)
+    {
+        count += counts[b].load(std::memory_order_relaxed);
+        cumulativeCounts[b] = count;
+    }
+    valueSum = sum.load(std::memory_order_relaxed);
+}
+
+
+MetricsRegistry::MetricsRegistry() : lastRender(std::chrono::steady_clock::now())
+{
+}
+
+MetricsRegistry& MetricsRegistry::global()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Metric& MetricsRegistry::getOrCreate(const std::string& name, const std::string& help)
+{
+    Metric& metric = metrics[name];
+    if (metric.help.empty())
+    {
+        metric.help = help;
+        metric.withRate = false;
+        metric.lastValue = 0;
+    }
+    return metric;
+}
+
+MetricsCounter& MetricsRegistry::counter(const std::string& name, const std::string& help, bool withRate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Metric& metric = getOrCreate(name, help);
+    if (metric.gauge || metric.histogram) throw std::invalid_argument("Metric " + name + " is not a counter");
+    if (!metric.counter) metric.counter.reset(new MetricsCounter());
+    metric.withRate = metric.withRate || withRate;
+    return *metric.counter;
+}
+
+MetricsGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Metric& metric = getOrCreate(name, help);
+    if (metric.counter || metric.histogram) throw std::invalid_argument("Metric " + name + " is not a gauge");
+    if (!metric.gauge) metric.gauge.reset(new MetricsGauge());
+    return *metric.gauge;
+}
+
+MetricsHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Metric& metric = getOrCreate(name, help);
+    if (metric.counter || metric.gauge) throw std::invalid_argument("Metric " + name + " is not a histogram");
+    if (!metric.histogram) metric.histogram.reset(new MetricsHistogram(bounds));
+    return *metric.histogram;
+}
+
+std::string MetricsRegistry::render()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastRender).count();
+    lastRender = now;
+    std::ostringstream text;
+    text << std::setprecision(10);
+    for (auto& entry : metrics)
+    {
+        const std::string& name = entry.first;
+        Metric& metric = entry.second;
+        if (metric.counter)
+        {
+            uint64_t value = metric.counter->get();
+            text << "# HELP " << name << "_total " << metric.help << "\n# TYPE " << name << "_total counter\n" << name << "_total " << value << "\n";
+            if (metric.withRate)
+            {
+                double rate = elapsed > 0 ? (value - metric.lastValue) / elapsed : 0.0;
+                text << "# HELP " << name << "_per_second " << metric.help << " per second since the previous snapshot\n# TYPE " << name << "_per_second gauge\n" << name << "_per_second " << rate << "\n";
+            }
+            metric.lastValue = value;
+        }
+        else if (metric.gauge)
+        {
+            text << "# HELP " << name << " " << metric.help << "\n# TYPE " << name << " gauge\n" << name << " " << metric.gauge->get() << "\n";
+        }
+        else if (metric.histogram)
+        {
+            std::vector<uint64_t> cumulativeCounts;
+            uint64_t count;
+            double valueSum;
+            metric.histogram->read(cumulativeCounts, count, valueSum);
+            const std::vector<double>& bounds = metric.histogram->getBounds();
+            text << "# HELP " << name << " " << metric.help << "\n# TYPE " << name << " histogram\n";
+            for (size_t b = 0; b < bounds.size(); b++)
+            {
+                text << name << "_bucket{le=\"" << bounds[b] << "\"} " << cumulativeCounts[b] << "\n";
+            }
+            text << name << "_bucket{le=\"+Inf\"} " << count << "\n" << name << "_sum " << valueSum << "\n" << name << "_count " << count << "\n";
+        }
+    }
+    return text.str();
+}
+
+
+MetricsPublisher::MetricsPublisher(MetricsRegistry& registry, const std::string& fileName, int port, double interval) :
+    registry(registry), fileName(fileName), port(port), interval(std::max(interval, 0.01)), listenSocket(-1), stopping(false)
+{
+    if (port > 0)
+    {
+        listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (listenSocket < 0 || bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 8) != 0)
+        {
+            if (listenSocket >= 0) close(listenSocket);
+            throw std::runtime_error("Could not open the metrics endpoint on port " + std::to_string(port));
+        }
+    }
+    publish();
+    std::cout << "----- Metrics are published every " << this->interval << " seconds" << (fileName.empty() ? "" : " to " + fileName) << (port > 0 ? " at http://127.0.0.1:" + std::to_string(port) + "/" : "") << " -----" << std::endl;
+    publisherThread = std::thread(&MetricsPublisher::runPublisher, this);
+    if (listenSocket >= 0) serverThread = std::thread(&MetricsPublisher::runServer, this);
+}
+
+MetricsPublisher::~MetricsPublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeUpMutex);
+        stopping.store(true);
+    }
+    wakeUp.notify_all();
+    publisherThread.join();
+    if (serverThread.joinable()) serverThread.join();
+    if (listenSocket >= 0) close(listenSocket);
+    publish();
+}
+
+void MetricsPublisher::publish()
+{
+    std::string text = registry.render();
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        snapshot = text;
+    }
+    if (fileName.empty()) return;
+    // Readers see either the previous or the new snapshot, never a partial one
+    std::string temporaryFileName = fileName + ".tmp";
+    {
+        std::ofstream file(temporaryFileName, std::ios::trunc);
+        file << text;
+        if (!file) return;
+    }
+    std::rename(temporaryFileName.c_str(), fileName.c_str());
+}
+
+void MetricsPublisher::runPublisher()
+{
+    std::unique_lock<std::mutex> lock(wakeUpMutex);
+    while (!stopping.load())
+    {
+        wakeUp.wait_for(lock, std::chrono::duration<double>(interval));
+        if (stopping.load()) break;
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+void MetricsPublisher::runServer()
+{
+    while (!stopping.load())
+    {
+        pollfd listening = {listenSocket, POLLIN, 0};
+        if (poll(&listening, 1, 200) <= 0) continue;
+        int client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) continue;
+        // The request is read (whatever it asks for, the snapshot is returned) with a timeout, so a silent client cannot hold the server
+        timeval timeout = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        char request[1024];
+        recv(client, request, sizeof(request), 0);
+        std::string body;
+        {
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            body = snapshot;
+        }
+        std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        for (size_t sent = 0; sent < response.size(); )
+        {
+            ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+        close(client);
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counter of a metric that only increases (e.g., simulated episodes). Updates are relaxed atomics, so they never block
+class MetricsCounter
+{
+public:
+	MetricsCounter() : value(0) {}
+	void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+	uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> value;
+};
+
+// Gauge of a metric that is set to its current value (e.g., the loss of the last update)
+class MetricsGauge
+{
+public:
+	MetricsGauge() : value(0.0) {}
+	void set(double v) { value.store(v, std::memory_order_relaxed); }
+	double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<double> value;
+};
+
+// Histogram with fixed bucket bounds. Hot loops count into a local vector of bucketOf and merge it from time to time
+class MetricsHistogram
+{
+public:
+	// Constructor: upper bounds of the buckets in increasing order, a last bucket without bound is added
+	MetricsHistogram(const std::vector<double>& bounds);
+
+	// Function that returns the bucket of a value (bounds.size() if above all bounds)
+	int bucketOf(double value) const;
+	int getNbBuckets() const { return (int)bounds.size() + 1; }
+	const std::vector<double>& getBounds() const { return bounds; }
+
+	// Functions to add one value, or the counts per bucket and the sum of many values
+	void observe(double value);
+	void merge(const std::vector<uint64_t>& bucketCounts, double valueSum);
+
+	// Function that returns the cumulative count of each bucket, the total count and the sum of all values
+	void read(std::vector<uint64_t>& cumulativeCounts, uint64_t& count, double& valueSum) const;
+
+private:
+	std::vector<double> bounds;								// Upper bounds of the buckets
+	std::unique_ptr<std::atomic<uint64_t>[]> counts;		// Number of values in each bucket (not cumulative)
+	std::atomic<double> sum;								// Sum of all values
+};
+
+// Registry of the metrics of the process. Instruments are created once by name (creating an existing one returns it) and keep their address,
+// so simulations hold pointers to them and update them without locks. Only creating and rendering take the lock
+class MetricsRegistry
+{
+public:
+	// Registry of the whole process
+	static MetricsRegistry& global();
+
+	// Functions that return the instrument of a name, created with help text on first use. For a counter with rate, its increase per second
+	// since the previous snapshot is exported as well
+	MetricsCounter& counter(const std::string& name, const std::string& help, bool withRate = false);
+	MetricsGauge& gauge(const std::string& name, const std::string& help);
+	MetricsHistogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+	// Function that returns a snapshot of all metrics in the Prometheus text format
+	std::string render();
+
+private:
+	struct Metric
+	{
+		std::string help;									// Help text
+		std::unique_ptr<MetricsCounter> counter;			// The instrument (exactly one is set)
+		std::unique_ptr<MetricsGauge> gauge;
+		std::unique_ptr<MetricsHistogram> histogram;
+		bool withRate;										// True if the rate of the counter is exported
+		uint64_t lastValue;									// Value of the counter at the previous snapshot
+	};
+
+	std::mutex mutex;
+	std::map<std::string, Metric> metrics;					// Metrics by name, exported in this order
+	std::chrono::steady_clock::time_point lastRender;		// Time of the previous snapshot
+
+	MetricsRegistry();
+	Metric& getOrCreate(const std::string& name, const std::string& help);
+};
+
+// Thread that renders a snapshot of a registry every interval seconds. The snapshot atomically replaces fileName (written next to it and renamed),
+// and a second thread serves the latest snapshot at http://127.0.0.1:<port>/ if port is positive. Simulation threads never wait for either
+class MetricsPublisher
+{
+public:
+	// Constructor: publishes the first snapshot and starts the threads. Throws if the port cannot be opened
+	MetricsPublisher(MetricsRegistry& registry, const std::string& fileName, int port, double interval);
+	// Destructor: stops the threads and publishes a last snapshot
+	~MetricsPublisher();
+
+private:
+	MetricsRegistry& registry;
+	std::string fileName;									// File of the snapshot (none if empty)
+	int port;												// Port of the HTTP endpoint on localhost (none if not positive)
+	double interval;										// Seconds between two snapshots
+	int listenSocket;										// Socket of the HTTP endpoint (-1 if none)
+	std::atomic<bool> stopping;
+	std::mutex wakeUpMutex;									// Wakes the publisher thread up early when stopping
+	std::condition_variable wakeUp;
+	std::mutex snapshotMutex;								// Latest snapshot, served by the HTTP endpoint
+	std::string snapshot;
+	std::thread publisherThread;
+	std::thread serverThread;
+
+	// Function that renders a snapshot and writes it to the file
+	void publish();
+	// Functions of the publisher thread and the HTTP server thread
+	void runPublisher();
+	void runServer();
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef ORDERQUEUE_H
+#define ORDERQUEUE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+// Implementation of a FIFO queue of pointers on a growable ring buffer, used for the backlog of orders of a warehouse
+// Enqueue and dequeue are O(1) (amortized when the buffer grows). Each element gets a handle, its absolute position in the queue,
+// which removes it in O(1) from anywhere: the cell is cleared and skipped once it reaches the front. The highest number
+// of waiting elements since the last clear is kept as high-water mark
+template <typename T>
+class OrderQueue
+{
+    std::vector<T*> buffer_;                    // Ring buffer, a null cell is a removed element
+    size_t mask_;                               // Capacity - 1, the capacity is a power of two
+    long long head_;                            // Position of the front cell
+    long long tail_;                            // Position the next element is written to
+    size_t size_;                               // Number of elements in the queue (removed cells excluded)
+    size_t highWaterMark_;                      // Highest size since the last clear
+
+    // Function that moves head_ past removed cells
+    void skipRemoved()
+    {
+        while (head_ < tail_ && buffer_[head_ & mask_] == nullptr) head_++;
+    }
+
+    // Function that doubles the capacity, each element keeps its position
+    void grow()
+    {
+        std::vector<T*> buffer(buffer_.size() * 2, nullptr);
+        size_t mask = buffer.size() - 1;
+        for (long long position = head_; position < tail_; position++)
+        {
+            buffer[position & mask] = buffer_[position & mask_];
+        }
+        buffer_.swap(buffer);
+        mask_ = mask;
+    }
+
+public:
+    // Iterator over the elements in FIFO order
+    class const_iterator
+    {
+        const OrderQueue* queue_;
+        long long position_;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T* value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T* const* pointer;
+        typedef T* reference;
+
+        const_iterator(const OrderQueue* queue, long long position) : queue_(queue), position_(position)
+        {
+            while (position_ < queue_->tail_ && queue_->buffer_[position_ & queue_->mask_] == nullptr) position_++;
+        }
+        T* operator*() const { return queue_->buffer_[position_ & queue_->mask_]; }
+        const_iterator& operator++()
+        {
+            position_++;
+            while (position_ < queue_->tail_ && queue_->buffer_[position_ & queue_->mask_] == nullptr) position_++;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return position_ == other.position_; }
+        bool operator!=(const const_iterator& other) const { return position_ != other.position_; }
+    };
+
+    // Constructor: capacity is rounded up to a power of two
+    OrderQueue(size_t capacity = 16) : mask_(0), head_(0), tail_(0), size_(0), highWaterMark_(0)
+    {
+        size_t c = 2;
+        while (c < capacity) c *= 2;
+        buffer_.assign(c, nullptr);
+        mask_ = c - 1;
+    }
+
+    // Function that appends a (non-null) element and returns its handle
+    long long push(T* element)
+    {
+        if (tail_ - head_ == (long long)buffer_.size()) grow();
+        buffer_[tail_ & mask_] = element;
+        size_++;
+        highWaterMark_ = std::max(highWaterMark_, size_);
+        return tail_++;
+    }
+
+    // Functions that return and remove the front element, the queue must not be empty
+    T* front() const { return buffer_[head_ & mask_]; }
+    void pop()
+    {
+        buffer_[head_ & mask_] = nullptr;
+        head_++;
+        size_--;
+        skipRemoved();
+    }
+
+    // Function that removes the element of a handle, returns false if it is not in the queue anymore (or the handle is negative)
+    bool remove(long long handle)
+    {
+        if (handle < head_ || handle >= tail_ || buffer_[handle & mask_] == nullptr) return false;
+        buffer_[handle & mask_] = nullptr;
+        size_--;
+        skipRemoved();
+        return true;
+    }
+
+    // Function that empties the queue and resets the high-water mark, the capacity is kept
+    void clear()
+    {
+        std::fill(buffer_.begin(), buffer_.end(), nullptr);
+        head_ = tail_ = 0;
+        size_ = 0;
+        highWaterMark_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return buffer_.size(); }
+    size_t highWaterMark() const { return highWaterMark_; }
+
+    const_iterator begin() const { return const_iterator(this, head_); }
+    const_iterator end() const { return const_iterator(this, tail_); }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <torch/torch.h>
+#include "Data.h"
+#include "Environment.h"
+#include "ParameterSweep.h"
+#include "ThreadManager.h"
+
+
+ParameterSweep::ParameterSweep(Data* data) : data(data)
+{
+    std::cout<<"----- Create Parameter Sweep -----"<<std::endl;
+}
+
+std::vector<float> ParameterSweep::parseList(std::string list)
+{
+    std::vector<float> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')){
+        if (!value.empty()){
+            values.push_back(std::stof(value));
+        }
+    }
+    return values;
+}
+
+int ParameterSweep::parseConfigurations(char * argv[])
+{
+    configurations = std::vector<LambdaConfiguration>(0);
+    std::string firstArgument(argv[6]);
+    if (firstArgument.find(':') != std::string::npos){
+        // List of pairs, e.g. "0.95:0.85,0.9:0.5"
+        std::stringstream stream(firstArgument);
+        std::string pair;
+        while (std::getline(stream, pair, ',')){
+            size_t separator = pair.find(':');
+            if (separator == std::string::npos) throw std::runtime_error("Could not parse lambda pair " + pair);
+            configurations.push_back({std::stof(pair.substr(0, separator)), std::stof(pair.substr(separator + 1))});
+        }
+        return 7;
+    }
+    // Grid of all combinations of the temporal and spatial values
+    if (argv[7] == nullptr) throw std::runtime_error("Missing list of spatial lambdas for the sweep grid");
+    for (float lambdaTemporal : parseList(argv[6])){
+        for (float lambdaSpatial : parseList(argv[7])){
+            configurations.push_back({lambdaTemporal, lambdaSpatial});
+        }
+    }
+    return 8;
+}
+
+void ParameterSweep::simulate(char * argv[])
+{
+    int timeLimit = std::stoi(argv[2])*3600;
+    int nextArgument = parseConfigurations(argv);
+    int nbConfigurations = configurations.size();
+    if (nbConfigurations == 0){
+        std::cerr<<"No lambda configurations given for the sweep."<<std::endl;
+        return;
+    }
+
+    // Split the cores between concurrently trained configurations and the torch intra-op threads of each configuration
+    int nbCores = std::max(1, (int)std::thread::hardware_concurrency());
+    int maxConcurrent = nbCores;
+    if (argv[nextArgument] != nullptr){
+        maxConcurrent = std::max(1, std::stoi(argv[nextArgument]));
+    }
+    int nbConcurrentConfigurations = std::min(nbConfigurations, maxConcurrent);
+    int nbIntraOpThreads = std::max(1, nbCores / nbConcurrentConfigurations);
+
+    std::cout<<"----- Sweep over " << nbConfigurations << " configurations: " << nbConcurrentConfigurations << " concurrently with " << nbIntraOpThreads << " intra-op threads each on " << nbCores << " cores -----"<<std::endl;
+    trainConfigurations(timeLimit, nbConcurrentConfigurations, nbIntraOpThreads);
+    std::cout<<"----- Sweep finished -----"<<std::endl;
+}
+
+void ParameterSweep::trainConfigurations(int timeLimit, int nbConcurrentConfigurations, int nbIntraOpThreads)
+{
+    // Workers pull the next configuration as soon as they are done, such that long configurations do not block the others
+    std::atomic<int> nextConfiguration(0);
+    torch::set_num_threads(nbIntraOpThreads);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < nbConcurrentConfigurations; w++){
+        workers.emplace_back([this, &nextConfiguration, timeLimit, nbIntraOpThreads, w](){
+            // The intra-op setting is per thread for OpenMP builds of libtorch, so every worker sets it again. Its intra-op threads inherit its CPUs
+            ThreadManager::global().pinSimulationThread(w, nbIntraOpThreads);
+            torch::set_num_threads(nbIntraOpThreads);
+            for (int c = nextConfiguration++; c < (int)configurations.size(); c = nextConfiguration++){
+                LambdaConfiguration configuration = configurations[c];
+                // Each configuration works on its own copy of the data (random number generator, arrival rate)
+                Data configurationData = *data;
+                Environment environment(&configurationData);
+                std::string netFileName = "src/assignmentNet_REINFORCE_" + std::to_string(configuration.lambdaTemporal) + "_" + std::to_string(configuration.lambdaSpatial) + ".pt";
+                environment.trainREINFORCE(timeLimit, configuration.lambdaTemporal, configuration.lambdaSpatial, netFileName);
+            }
+        });
+    }
+    for (std::thread& worker : workers){
+        worker.join();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <string>
+#include <vector>
+
+#include "Data.h"
+
+// Structure of a configuration of the discount parameters that is trained in a sweep
+struct LambdaConfiguration
+{
+	float lambdaTemporal;			// Temporal discount parameter of the REINFORCE costs
+	float lambdaSpatial;			// Spatial discount parameter of the REINFORCE costs
+};
+
+// Class that trains several lambda configurations concurrently within one process.
+// The instance is read only once; each configuration then trains on its own copy of the Data, such that the random number generator and
+// the arrival rate evolve exactly as if the configuration was trained in a separate process
+class ParameterSweep
+{
+public:
+	// Constructor
+	ParameterSweep(Data* data);
+
+	// Function to perform the sweep. Expects either a grid (argv[6]: lambdaTemporal list, argv[7]: lambdaSpatial list)
+	// or a list of pairs (argv[6]: "lt:ls,lt:ls,..."), followed by an optional maximum number of concurrent configurations
+	void simulate(char * argv[]);
+
+private:
+	Data* data;											// Problem parameters, only read
+	std::vector<LambdaConfiguration> configurations;	// Configurations that are trained
+
+	// Function that parses a comma separated list of floats
+	std::vector<float> parseList(std::string list);
+
+	// Function that creates the configurations from the command line
+	int parseConfigurations(char * argv[]);
+
+	// Function that trains all configurations with the given number of concurrent configurations and torch intra-op threads per configuration
+	void trainConfigurations(int timeLimit, int nbConcurrentConfigurations, int nbIntraOpThreads);
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "Simulator.h"
+
+namespace py = pybind11;
+
+// Function that moves a vector to the heap and returns a NumPy array on its buffer. A capsule owns the vector, so nothing is copied
+template <typename T>
+py::array_t<T> toArray(std::vector<T>&& values, const std::vector<py::ssize_t>& shape)
+{
+    std::vector<T>* owner = new std::vector<T>(std::move(values));
+    py::capsule freeWhenDone(owner, [](void* pointer) { delete static_cast<std::vector<T>*>(pointer); });
+    return py::array_t<T>(shape, owner->data(), freeWhenDone);
+}
+
+PYBIND11_MODULE(onlineAssignmentPy, m)
+{
+    m.doc() = "In-process simulation of the online assignment of orders to warehouses";
+
+    py::class_<Simulator>(m, "Simulator")
+        // The content of an instance file as bytes (text or binary format) is read from memory, a str is the name of an instance file
+        .def(py::init([](py::bytes instance, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options){
+                std::istringstream stream(std::string(instance), std::ios::binary);
+                return new Simulator(stream, penaltyForNotServing, interArrivalTime, options);
+            }), py::arg("instance"), py::arg("penaltyForNotServing"), py::arg("interArrivalTime"), py::arg("options") = std::map<std::string, std::string>())
+        .def(py::init<const std::string&, int, double, const std::map<std::string, std::string>&>(),
+            py::arg("fileName"), py::arg("penaltyForNotServing"), py::arg("interArrivalTime"), py::arg("options") = std::map<std::string, std::string>())
+        .def_property_readonly("nbClients", [](const Simulator& simulator){ return simulator.getData().nbClients; })
+        .def_property_readonly("nbWarehouses", [](const Simulator& simulator){ return simulator.getData().nbWarehouses; })
+        // Returns a dict of arrays with one entry per replication, waitingTimeQuantiles has the shape (nbReplications, 4). The GIL is released
+        // during the simulation, so Python threads with a simulator each run in parallel; calls on the same simulator wait for each other
+        .def("run", [](Simulator& simulator, const std::string& method, int hours, int nbReplications, int firstEpoch, int batchWindow){
+                ReplicationResults results;
+                {
+                    py::gil_scoped_release release;
+                    results = simulator.run(method, hours, nbReplications, firstEpoch, batchWindow);
+                }
+                py::ssize_t n = results.costs.size();
+                py::dict stats;
+                stats["costs"] = toArray(std::move(results.costs), {n});
+                stats["rejectionRates"] = toArray(std::move(results.rejectionRates), {n});
+                stats["meanWaitingTimes"] = toArray(std::move(results.meanWaitingTimes), {n});
+                stats["maxWaitingTimes"] = toArray(std::move(results.maxWaitingTimes), {n});
+                stats["waitingTimeQuantiles"] = toArray(std::move(results.waitingTimeQuantiles), {n, 4});
+                return stats;
+            }, py::arg("method"), py::arg("hours"), py::arg("nbReplications"), py::arg("firstEpoch") = 0, py::arg("batchWindow") = 30);
+}
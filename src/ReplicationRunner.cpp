@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <torch/torch.h>
+#include "Data.h"
+#include "Environment.h"
+#include "KpiStatistics.h"
+#include "ReplicationRunner.h"
+#include "ThreadManager.h"
+
+// Header of the shared memory. Lock-free atomics are address-free, so they work between processes
+struct ReplicationQueue
+{
+    std::atomic<int> nextChunk;         // Next chunk that has not been taken by a worker
+    std::atomic<int> nbEpochsDone;      // Number of epochs whose record has been written
+};
+
+
+ReplicationRunner::ReplicationRunner(Data* data) : data(data), sharedMemory(nullptr), sharedMemorySize(0)
+{
+    std::cout<<"----- Create Replication Runner -----"<<std::endl;
+    nbWorkers = std::max(1, (int)data->getOption("workers", 1.0));
+    nbEpochs = std::max(1, (int)data->getOption("maxEpochs", 1000.0));
+    chunkSize = std::max(1, (int)data->getOption("chunkSize", 10.0));
+    nbThreadsPerWorker = std::max(1, (int)data->getOption("threadsPerWorker", 1.0));
+    nbChunks = (nbEpochs + chunkSize - 1) / chunkSize;
+}
+
+int ReplicationRunner::seedOfEpoch(int epoch)
+{
+    // Finalizer of MurmurHash3, such that the seeds of consecutive epochs differ in all bits
+    uint32_t hash = (uint32_t)(epoch + 1) * 0x9e3779b9U;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return (int)hash;
+}
+
+int ReplicationRunner::startWorker(char * argv[], int timeLimit, int worker, int firstChunk)
+{
+    // Buffered output would otherwise be written by the parent and the child
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0){
+        throw std::runtime_error("Could not fork a worker process");
+    }
+    if (pid == 0){
+        int exitCode = 0;
+        try{
+            runWorker(argv, timeLimit, worker, firstChunk);
+        }catch (const std::exception& exception){
+            std::cerr<<"----- Worker " << worker << " failed: " << exception.what() << " -----"<<std::endl;
+            exitCode = 1;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        // The worker must not run the destructors and exit handlers of the coordinator
+        _exit(exitCode);
+    }
+    return pid;
+}
+
+void ReplicationRunner::runWorker(char * argv[], int timeLimit, int worker, int firstChunk)
+{
+    // The intra-op threads of the worker are created by this process, so they inherit the CPUs of its pinning
+    ThreadManager::global().pinReplicationWorker(worker, nbThreadsPerWorker);
+    torch::set_num_threads(nbThreadsPerWorker);
+    Environment environment(data);
+    int chunk = firstChunk >= 0 ? firstChunk : queue->nextChunk.fetch_add(1);
+    while (chunk < nbChunks){
+        workerChunks[worker].store(chunk);
+        for (int epoch = chunk * chunkSize; epoch < std::min(nbEpochs, (chunk + 1) * chunkSize); epoch++){
+            // A replacement worker skips the epochs that the crashed worker finished
+            if (epochsDone[epoch].load(std::memory_order_acquire)){
+                continue;
+            }
+            records[epoch] = environment.simulateReplication(argv, timeLimit, seedOfEpoch(epoch));
+            records[epoch].epoch = epoch;
+            environment.getEpisodeKpis(waitingTimeRecords[epoch], warehouseRecords + (size_t)epoch * data->nbWarehouses);
+            epochsDone[epoch].store(1, std::memory_order_release);
+            queue->nbEpochsDone.fetch_add(1);
+        }
+        chunk = queue->nextChunk.fetch_add(1);
+    }
+    workerChunks[worker].store(-1);
+}
+
+void ReplicationRunner::simulate(char * argv[])
+{
+    // Checked before forking, otherwise every worker would fail and its chunks would be retried
+    std::string method(argv[5]);
+    if (method != "nearestWarehouse" && method != "testREINFORCE" && method != "batchAssignment" && method != "rollout"){
+        throw std::invalid_argument("Method " + method + " cannot be replicated with --workers");
+    }
+    if (method == "testREINFORCE" && (argv[6] == nullptr || argv[7] == nullptr)){
+        throw std::invalid_argument("testREINFORCE needs the arguments lambdaTemporal lambdaSpatial");
+    }
+    if (data->hasOption("replay")){
+        throw std::invalid_argument("--replay cannot check replications with --workers");
+    }
+    // The replications always simulate all --maxEpochs epochs of the method alone, options that would change what is estimated are refused
+    for (const char* option : {"targetHalfWidth", "minEpochs", "baseline"}){
+        if (data->hasOption(option)){
+            throw std::invalid_argument("--" + std::string(option) + " is not supported with --workers");
+        }
+    }
+    for (const char* option : {"eventLog", "metricsFile", "metricsPort"}){
+        if (data->hasOption(option)){
+            std::cout<<"----- --" << option << " has no effect with --workers -----"<<std::endl;
+        }
+    }
+    int timeLimit = std::stoi(argv[2])*3600;
+    std::cout<<"----- Replications: " << nbEpochs << " epochs of " << argv[5] << " in chunks of " << chunkSize << " on " << nbWorkers << " worker processes with " << nbThreadsPerWorker << " intra-op threads each -----"<<std::endl;
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Layout of the shared memory: queue header, chunk of each worker, done flag of each epoch, record, waiting times and warehouse counters of each epoch
+    auto align = [](size_t offset, size_t alignment){ return (offset + alignment - 1) / alignment * alignment; };
+    size_t recordsOffset = align(sizeof(ReplicationQueue) + (nbWorkers + nbEpochs) * sizeof(std::atomic<int>), alignof(ReplicationRecord));
+    size_t waitingTimesOffset = align(recordsOffset + nbEpochs * sizeof(ReplicationRecord), alignof(WaitingTimeHistogram));
+    size_t warehousesOffset = align(waitingTimesOffset + nbEpochs * sizeof(WaitingTimeHistogram), alignof(WarehouseStatistics));
+    sharedMemorySize = warehousesOffset + (size_t)nbEpochs * data->nbWarehouses * sizeof(WarehouseStatistics);
+    sharedMemory = mmap(nullptr, sharedMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sharedMemory == MAP_FAILED){
+        throw std::runtime_error("Could not map shared memory for the replications");
+    }
+    char* memory = (char*)sharedMemory;
+    queue = new (memory) ReplicationQueue();
+    queue->nextChunk.store(0);
+    queue->nbEpochsDone.store(0);
+    workerChunks = (std::atomic<int>*)(memory + sizeof(ReplicationQueue));
+    epochsDone = workerChunks + nbWorkers;
+    for (int w = 0; w < nbWorkers; w++){
+        new (&workerChunks[w]) std::atomic<int>(-1);
+    }
+    for (int e = 0; e < nbEpochs; e++){
+        new (&epochsDone[e]) std::atomic<int>(0);
+    }
+    records = (ReplicationRecord*)(memory + recordsOffset);
+    waitingTimeRecords = (WaitingTimeHistogram*)(memory + waitingTimesOffset);
+    warehouseRecords = (WarehouseStatistics*)(memory + warehousesOffset);
+    for (int e = 0; e < nbEpochs; e++){
+        new (&waitingTimeRecords[e]) WaitingTimeHistogram();
+    }
+    for (size_t w = 0; w < (size_t)nbEpochs * data->nbWarehouses; w++){
+        new (&warehouseRecords[w]) WarehouseStatistics();
+    }
+
+    std::vector<pid_t> workers(nbWorkers);
+    for (int w = 0; w < nbWorkers; w++){
+        workers[w] = startWorker(argv, timeLimit, w, -1);
+    }
+
+    // The coordinator waits for the workers. The chunk of a crashed worker is given to a replacement worker once, then it is skipped
+    std::vector<int> nbAttempts(nbChunks, 0);
+    int nbRunning = nbWorkers;
+    int nbRestarts = 0;
+    while (nbRunning > 0){
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0){
+            if (errno == EINTR) continue;
+            break;
+        }
+        int worker = std::find(workers.begin(), workers.end(), pid) - workers.begin();
+        if (worker == nbWorkers) continue;
+        nbRunning--;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+        int chunk = workerChunks[worker].load();
+        std::cout<<"----- Worker " << worker << " (process " << pid << ") " << (WIFSIGNALED(status) ? "was killed by signal " + std::to_string(WTERMSIG(status)) : "exited with code " + std::to_string(WEXITSTATUS(status))) << " in chunk " << chunk << " -----"<<std::endl;
+        bool retryChunk = chunk >= 0 && ++nbAttempts[chunk] <= 1;
+        if ((retryChunk || queue->nextChunk.load() < nbChunks) && nbRestarts < nbChunks){
+            workers[worker] = startWorker(argv, timeLimit, worker, retryChunk ? chunk : -1);
+            nbRunning++;
+            nbRestarts++;
+        }
+    }
+
+    // Records are gathered in the order of the epochs, and their waiting times and warehouse counters merged like the epochs of one process
+    std::vector<ReplicationRecord> finishedRecords;
+    RunningEstimate costEstimate;
+    DecisionCacheStatistics decisionCacheStatistics;
+    WaitingTimeHistogram allWaitingTimes;
+    std::vector<WarehouseStatistics> allWarehouseStatistics(data->nbWarehouses);
+    for (int e = 0; e < nbEpochs; e++){
+        if (epochsDone[e].load(std::memory_order_acquire)){
+            finishedRecords.push_back(records[e]);
+            costEstimate.add(records[e].objValue);
+            decisionCacheStatistics.merge(records[e].decisionCache);
+            allWaitingTimes.merge(waitingTimeRecords[e]);
+            for (int w = 0; w < data->nbWarehouses; w++){
+                allWarehouseStatistics[w].merge(warehouseRecords[(size_t)e * data->nbWarehouses + w]);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    munmap(sharedMemory, sharedMemorySize);
+    sharedMemory = nullptr;
+
+    if (!finishedRecords.empty()){
+        Environment environment(data);
+        environment.writeReplicationsToFile(argv, finishedRecords, allWaitingTimes, allWarehouseStatistics);
+    }
+    std::cout<< "Iterations: " << finishedRecords.size() << " Average costs: " << costEstimate.mean <<std::endl;
+    std::cout<< "Waiting time P50: " << allWaitingTimes.quantile(0.5) << " P90: " << allWaitingTimes.quantile(0.9) << " P95: " << allWaitingTimes.quantile(0.95) << " P99: " << allWaitingTimes.quantile(0.99) << " seconds" <<std::endl;
+    std::cout<< "Mean costs: " << costEstimate.mean << " +- " << costEstimate.halfWidth() << " (95% confidence) after " << costEstimate.count << " epochs" <<std::endl;
+    std::cout<< "Replications finished: " << finishedRecords.size() << " of " << nbEpochs << " in " << seconds << " seconds. Restarted workers: " << nbRestarts <<std::endl;
+    if (decisionCacheStatistics.nbHits + decisionCacheStatistics.nbMisses > 0){
+        // Each worker process fills its own cache
+        std::cout<< decisionCacheStatistics.describe() <<std::endl;
+    }
+}
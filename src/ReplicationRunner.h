@@ -0,0 +1,55 @@
+#ifndef REPLICATIONRUNNER_H
+#define REPLICATIONRUNNER_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Data.h"
+#include "Environment.h"
+#include "KpiStatistics.h"
+
+struct ReplicationQueue;
+
+// Class that shards the replications of an evaluating method over several worker processes on one machine.
+// The coordinator forks the workers after the instance has been read, so they share its pages. Workers pull chunks of consecutive epochs from a
+// work queue in anonymous shared memory and write one ReplicationRecord, waiting time histogram and set of warehouse counters per epoch next to it,
+// which the coordinator merges in the order of the epochs; the seed of an epoch only depends on its index.
+// A worker that crashes only loses its current chunk, which is handed to a replacement worker once. Each worker keeps its own small libtorch
+// thread pool, so the workers do not compete for the cores
+class ReplicationRunner
+{
+public:
+	// Constructor
+	ReplicationRunner(Data* data);
+
+	// Function to perform the replications of the method of argv[5] with --workers processes and write them to its statsData file
+	void simulate(char * argv[]);
+
+	// Function that returns the seed of the random numbers of an epoch
+	static int seedOfEpoch(int epoch);
+
+private:
+	Data* data;										// Problem parameters, only read by the coordinator
+	int nbWorkers;									// Number of worker processes
+	int nbEpochs;									// Number of replications
+	int chunkSize;									// Number of consecutive epochs a worker takes from the queue at once
+	int nbThreadsPerWorker;							// Number of libtorch intra-op threads of each worker
+	int nbChunks;									// Number of chunks of epochs
+	void* sharedMemory;								// Shared memory of the work queue and the records, and its size (in bytes)
+	size_t sharedMemorySize;
+	ReplicationQueue* queue;						// Work queue at the start of the shared memory
+	std::atomic<int>* workerChunks;					// Chunk each worker is simulating (-1 if none)
+	std::atomic<int>* epochsDone;					// 1 for each epoch whose record has been written
+	ReplicationRecord* records;						// Record of each epoch
+	WaitingTimeHistogram* waitingTimeRecords;		// Waiting times of each epoch
+	WarehouseStatistics* warehouseRecords;			// Counters of each warehouse in each epoch (data->nbWarehouses per epoch)
+
+	// Function that forks a worker process that starts with chunk firstChunk (-1 to take the next one from the queue). Returns its process ID
+	int startWorker(char * argv[], int timeLimit, int worker, int firstChunk);
+
+	// Function that runs in a worker process: simulates the epochs of the chunks it takes from the queue
+	void runWorker(char * argv[], int timeLimit, int worker, int firstChunk);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ResultsStore.h"
+
+
+namespace
+{
+    void appendUint32(std::vector<char>& buffer, uint32_t value)
+    {
+        for (int b = 0; b < 4; b++)
+        {
+            buffer.push_back((char)(value >> (8 * b) & 0xFF));
+        }
+    }
+
+    void appendString(std::vector<char>& buffer, const std::string& text)
+    {
+        appendUint32(buffer, text.size());
+        buffer.insert(buffer.end(), text.begin(), text.end());
+    }
+}
+
+ResultsWriter::ResultsWriter(const std::string& fileName, const std::map<std::string, std::string>& metadata, const std::vector<std::string>& columns, size_t rowsPerBlock) :
+    metadata(metadata), columns(columns), rowsPerBlock(rowsPerBlock > 0 ? rowsPerBlock : 1), values(columns.size())
+{
+    fileDescriptor = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fileDescriptor < 0) throw std::runtime_error("Could not open the results store " + fileName + ": " + std::strerror(errno));
+}
+
+ResultsWriter::~ResultsWriter()
+{
+    // A destructor must not throw (e.g., while an exception unwinds the stack), so a failed last block is only reported
+    try
+    {
+        flush();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+    close(fileDescriptor);
+}
+
+void ResultsWriter::addRow(const std::vector<double>& row)
+{
+    if (row.size() != columns.size()) throw std::invalid_argument("A row of the results store needs one value per column");
+    for (size_t c = 0; c < columns.size(); c++)
+    {
+        values[c].push_back(row[c]);
+    }
+    if (values.empty() || values[0].size() >= rowsPerBlock) flush();
+}
+
+void ResultsWriter::flush()
+{
+    size_t nbRows = values.empty() ? 0 : values[0].size();
+    if (nbRows == 0) return;
+    std::vector<char> block;
+    block.insert(block.end(), {'O', 'R', 'S', '1'});
+    appendUint32(block, 0);
+    appendUint32(block, nbRows);
+    appendUint32(block, columns.size());
+    appendUint32(block, metadata.size());
+    for (const auto& entry : metadata)
+    {
+        appendString(block, entry.first);
+        appendString(block, entry.second);
+    }
+    for (const std::string& column : columns)
+    {
+        appendString(block, column);
+    }
+    // The values start at a multiple of 8 bytes from the start of the block, and blocks have a multiple of 8 bytes, so readers can map them in place
+    block.resize((block.size() + 7) / 8 * 8, 0);
+    for (const std::vector<double>& column : values)
+    {
+        for (double value : column)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            for (int b = 0; b < 8; b++)
+            {
+                block.push_back((char)(bits >> (8 * b) & 0xFF));
+            }
+        }
+    }
+    uint32_t size = block.size();
+    for (int b = 0; b < 4; b++)
+    {
+        block[4 + b] = (char)(size >> (8 * b) & 0xFF);
+    }
+    // A single write appends the whole block, a partial write (e.g., a full disk) is completed with further writes
+    for (size_t written = 0; written < block.size(); )
+    {
+        ssize_t n = write(fileDescriptor, block.data() + written, block.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error(std::string("Could not append to the results store: ") + std::strerror(errno));
+        written += n;
+    }
+    for (std::vector<double>& column : values)
+    {
+        column.clear();
+    }
+}
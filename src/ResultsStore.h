@@ -0,0 +1,40 @@
+#ifndef RESULTSSTORE_H
+#define RESULTSSTORE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Writer of an append-only columnar results file, e.g., one file for a whole campaign of experiments (see python/resultsStore.py to read it).
+// The file is a sequence of self-describing blocks, each with the metadata of its run (instance, penalty, method, ...) and a table of per-epoch metrics:
+//   "ORS1", uint32 size of the block in bytes, uint32 rows, uint32 columns, uint32 metadata entries
+//   each metadata entry as uint32 length + key and uint32 length + value, then each column name as uint32 length + name
+//   zero padding to a multiple of 8 bytes, then the float64 values of each column, one column after the other
+// All numbers are little-endian. Rows are buffered in memory and each block is appended with a single write to a file opened with O_APPEND,
+// so writers in parallel threads or processes need no lock and their blocks never interleave (on local file systems).
+// A writer that is killed while writing can leave a truncated last block, which readers skip
+class ResultsWriter
+{
+public:
+	// Constructor: opens (or creates) fileName for appending. Throws if it cannot be opened. A block is written every rowsPerBlock rows
+	ResultsWriter(const std::string& fileName, const std::map<std::string, std::string>& metadata, const std::vector<std::string>& columns, size_t rowsPerBlock = 65536);
+	// Destructor: writes the remaining rows and closes the file. Unlike flush, it reports a failed write on std::cerr instead of throwing
+	~ResultsWriter();
+
+	// Function that adds a row with one value per column
+	void addRow(const std::vector<double>& values);
+	// Function that appends the buffered rows as one block
+	void flush();
+
+private:
+	int fileDescriptor;									// File opened with O_APPEND
+	std::map<std::string, std::string> metadata;		// Metadata of the run, repeated in each block
+	std::vector<std::string> columns;					// Names of the columns
+	size_t rowsPerBlock;								// Maximum number of rows of a block
+	std::vector<std::vector<double>> values;			// Buffered values of each column
+
+	ResultsWriter(const ResultsWriter&) = delete;
+	ResultsWriter& operator=(const ResultsWriter&) = delete;
+};
+
+#endif
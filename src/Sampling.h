@@ -0,0 +1,53 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "xorshift128.h"
+
+// Functions that sample actions directly from the output buffer of a policy net, i.e., from rows of non-negative (not necessarily normalized) weights.
+// Each row costs exactly one draw of the random number generator, so the random number stream only depends on the number of decisions.
+// Sampling is by inverse CDF: a uniform number times the sum of the row is compared with the running sum of the weights, without allocating anything
+
+// Function that returns a uniform random number in [0, 1) from one draw of the random number generator
+inline double drawUniform(XorShift128& rng)
+{
+    return rng() * (1.0 / 4294967296.0);
+}
+
+// Function that samples an index of the row weights[0..nbColumns-1] with probability proportional to its weight, given a uniform number u in [0, 1)
+inline int sampleFromRow(const float* weights, int nbColumns, double u)
+{
+    double total = 0.0;
+    for (int c = 0; c < nbColumns; c++)
+    {
+        total += weights[c];
+    }
+    double threshold = u * total;
+    double cumulative = 0.0;
+    int lastPositive = 0;
+    for (int c = 0; c < nbColumns; c++)
+    {
+        if (weights[c] <= 0.0f) continue;
+        cumulative += weights[c];
+        lastPositive = c;
+        if (threshold < cumulative) return c;
+    }
+    // Rounding can leave the threshold at the total, then the last index with positive weight is taken
+    return lastPositive;
+}
+
+// Function that returns the index of the largest weight of each row (greedy decisions) and writes them to actions
+inline void argmaxRows(const float* weights, int nbRows, int nbColumns, int* actions)
+{
+    for (int r = 0; r < nbRows; r++)
+    {
+        const float* row = weights + (long)r * nbColumns;
+        int best = 0;
+        for (int c = 1; c < nbColumns; c++)
+        {
+            if (row[c] > row[best]) best = c;
+        }
+        actions[r] = best;
+    }
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "SimulationState.h"
+
+
+SimulationState::SimulationState(const Data* data) : data(data), currentTime(0), costs(0)
+{
+    // Couriers are numbered warehouse by warehouse, as in Environment::initialize
+    for (int w = 0; w < data->nbWarehouses; w++)
+    {
+        std::shared_ptr<WarehouseState> warehouse = std::make_shared<WarehouseState>();
+        for (int c = 0; c < data->paramWarehouses[w].initialNbCouriers; c++)
+        {
+            warehouse->couriers.push_back(couriers.size());
+            couriers.push_back(StateCourier{0, -1, w});
+        }
+        warehouse->pickerTimes = std::vector<int>(data->paramWarehouses[w].initialNbPickers, 0);
+        warehouses.push_back(warehouse);
+    }
+}
+
+SimulationState SimulationState::snapshot() const
+{
+    return *this;
+}
+
+void SimulationState::restore(const SimulationState& state)
+{
+    *this = state;
+}
+
+WarehouseState& SimulationState::mutableWarehouse(int warehouse)
+{
+    // The warehouse is cloned before the first change if another state still refers to it
+    if (warehouses[warehouse].use_count() > 1)
+    {
+        warehouses[warehouse] = std::make_shared<WarehouseState>(*warehouses[warehouse]);
+    }
+    return *warehouses[warehouse];
+}
+
+int SimulationState::addOrder(const StateOrder& order)
+{
+    int index = orders.size();
+    orders.push_back(order);
+    if (order.arrivalTime >= 0)
+    {
+        insertInDelivery(index);
+    }
+    return index;
+}
+
+int SimulationState::addArrival(int client, int timeToComission, int serviceTimeAtClient, int warehouse)
+{
+    int index = addOrder(StateOrder{client, warehouse, currentTime, timeToComission, serviceTimeAtClient, -1, -1, -1});
+    if (warehouse < 0)
+    {
+        costs += data->penaltyForNotServing;
+        return index;
+    }
+    // The fastest picker comissions the order, see Environment::choosePickerForOrder
+    WarehouseState& state = mutableWarehouse(warehouse);
+    int picker = std::min_element(state.pickerTimes.begin(), state.pickerTimes.end()) - state.pickerTimes.begin();
+    state.pickerTimes[picker] = std::max(state.pickerTimes[picker], currentTime) + timeToComission;
+    orders[index].picker = picker;
+    if (!state.couriers.empty())
+    {
+        assignCourier(index);
+    }
+    else
+    {
+        state.queue.push_back(index);
+    }
+    return index;
+}
+
+void SimulationState::assignCourier(int order)
+{
+    // The fastest courier at the warehouse leaves once the picker is done, see Environment::chooseCourierForOrder
+    StateOrder& o = orders[order];
+    WarehouseState& state = mutableWarehouse(o.warehouse);
+    auto fastest = std::min_element(state.couriers.begin(), state.couriers.end(), [this](int a, int b) { return couriers[a].timeWhenAvailable < couriers[b].timeWhenAvailable; });
+    int courier = *fastest;
+    state.couriers.erase(fastest);
+    int departureTime = std::max(currentTime, std::max(couriers[courier].timeWhenAvailable, state.pickerTimes[o.picker]));
+    int arrivalTime = departureTime + data->travelTime.get(o.client, o.warehouse, departureTime);
+    couriers[courier].order = order;
+    couriers[courier].timeWhenAvailable = currentTime;
+    o.arrivalTime = arrivalTime;
+    o.courier = courier;
+    insertInDelivery(order);
+}
+
+void SimulationState::insertInDelivery(int order)
+{
+    // Same position as in Environment::AddOrderToVector: before the orders that arrive at the same time
+    const int arrivalTime = orders[order].arrivalTime;
+    auto position = std::lower_bound(ordersInDelivery.begin(), ordersInDelivery.end(), arrivalTime, [this](int other, int time) { return orders[other].arrivalTime < time; });
+    ordersInDelivery.insert(position, order);
+}
+
+void SimulationState::serveNextOrder()
+{
+    // The courier serves the client and drives back to his warehouse, see Environment::chooseClosestWarehouseForCourier
+    int order = ordersInDelivery.front();
+    ordersInDelivery.erase(ordersInDelivery.begin());
+    const StateOrder& o = orders[order];
+    StateCourier& c = couriers[o.courier];
+    int departureTime = o.arrivalTime + o.serviceTimeAtClient;
+    c.timeWhenAvailable = departureTime + data->travelTime.get(o.client, c.warehouse, departureTime);
+    c.order = -1;
+    costs += o.arrivalTime - o.orderTime;
+    WarehouseState& state = mutableWarehouse(c.warehouse);
+    state.couriers.push_back(o.courier);
+    // An order waiting at the warehouse now gets a courier
+    if (!state.queue.empty())
+    {
+        int waitingOrder = state.queue.front();
+        state.queue.erase(state.queue.begin());
+        assignCourier(waitingOrder);
+    }
+}
+
+void SimulationState::advanceTo(int time)
+{
+    // Couriers that arrive at the same time as an order are processed first, as in Environment::simulateEpisode
+    while (!ordersInDelivery.empty() && orders[ordersInDelivery.front()].arrivalTime <= time)
+    {
+        currentTime = std::max(currentTime, orders[ordersInDelivery.front()].arrivalTime);
+        serveNextOrder();
+    }
+    currentTime = std::max(currentTime, time);
+}
+
+void SimulationState::drain()
+{
+    advanceTo(INT_MAX);
+    // Orders at warehouses without couriers are never served and count with the penalty, as in Environment::getObjValue
+    for (const std::shared_ptr<WarehouseState>& warehouse : warehouses)
+    {
+        costs += (long long)warehouse->queue.size() * data->penaltyForNotServing;
+    }
+}
+
+int SimulationState::nearestWarehouse(int client) const
+{
+    const int* travelTimes = data->travelTime.getRowData(client, currentTime);
+    int closest = -1;
+    if (data->clientZones.empty())
+    {
+        closest = std::min_element(travelTimes, travelTimes + data->nbWarehouses) - travelTimes;
+    }
+    else
+    {
+        // Only warehouses whose service zone contains the client are considered (as in Environment::chooseClosestWarehouseForOrder)
+        for (int w = 0; w < data->nbWarehouses; w++)
+        {
+            if ((data->clientZones[client] >> w & 1) && (closest < 0 || travelTimes[w] < travelTimes[closest])) closest = w;
+        }
+        if (closest < 0) return -1;
+    }
+    const WarehouseState& state = *warehouses[closest];
+    bool pickerAvailable = std::any_of(state.pickerTimes.begin(), state.pickerTimes.end(), [this](int time) { return time < currentTime; });
+    return (!state.couriers.empty() && pickerAvailable) ? closest : -1;
+}
+
+void SimulationState::rollout(int horizon, int timeLimit, XorShift128& rng)
+{
+    // Arrivals are drawn one by one from the arrival rate profile, with the same distributions as Environment::drawArrivals
+    const double end = std::min((double)currentTime + horizon, (double)timeLimit);
+    std::exponential_distribution<double> comission(1.0 / data->meanCommissionTime);
+    std::exponential_distribution<double> service(1.0 / data->meanServiceTimeAtClient);
+    std::vector<double> arrivalTimes;
+    double clock = currentTime;
+    for (;;)
+    {
+        arrivalTimes.clear();
+        data->arrivalProfile.drawArrivalTimes(clock, 1, rng, arrivalTimes);
+        clock = arrivalTimes[0];
+        if (clock >= end) break;
+        advanceTo(std::lround(clock));
+        int client = data->clientSampler.sample(rng);
+        int timeToComission = std::round(comission(rng));
+        int serviceTimeAtClient = std::round(service(rng));
+        addArrival(client, timeToComission, serviceTimeAtClient, nearestWarehouse(client));
+    }
+    drain();
+}
@@ -0,0 +1,96 @@
+#ifndef SIMULATIONSTATE_H
+#define SIMULATIONSTATE_H
+
+#include <memory>
+#include <vector>
+
+#include "Data.h"
+#include "xorshift128.h"
+
+// Order of a simulation state, referring to clients, warehouses and couriers by their index
+struct StateOrder
+{
+	int client;					// Index of the client
+	int warehouse;				// Index of the warehouse the order is assigned to (-1 if rejected or not assigned yet)
+	int orderTime;				// Time the order arrives in the system
+	int timeToComission;		// Time it takes to comission the order
+	int serviceTimeAtClient;	// Time it takes to serve the client at the door
+	int picker;					// Index of the picker (within the warehouse) that comissions the order
+	int arrivalTime;			// Time the courier arrives at the client (-1 if no courier is assigned yet)
+	int courier;				// Index of the courier assigned to the order (-1 if none)
+};
+
+// Courier of a simulation state
+struct StateCourier
+{
+	int timeWhenAvailable;		// Time the courier is available again (as in Courier)
+	int order;					// Index of the order the courier delivers (-1 if at or heading to its warehouse)
+	int warehouse;				// Index of the warehouse of the courier
+};
+
+// Part of a simulation state that belongs to one warehouse. It is shared between copies of a state until one of them changes it
+struct WarehouseState
+{
+	std::vector<int> couriers;		// Couriers at the warehouse, in the order they arrived (as couriersAssigned)
+	std::vector<int> pickerTimes;	// Time when each picker of the warehouse is available again
+	std::vector<int> queue;			// Orders that wait for a courier, first come first served
+};
+
+// Index-based copy of the state of an episode that can be simulated further without touching the episode, e.g., to look ahead before a decision.
+// Orders and couriers are plain structures in flat vectors, so copying a state is a few memcpy. Warehouses are copy-on-write: a copy shares
+// them with the original and only clones the ones it changes. The dynamics are the ones of Environment: the fastest picker comissions an order,
+// the fastest courier at the warehouse delivers it and drives back to the same warehouse, orders without a courier wait in a queue
+class SimulationState
+{
+public:
+	// Constructor: empty state at time 0 with the warehouses, couriers and pickers of data
+	SimulationState(const Data* data);
+
+	// Functions that return a copy of the state (sharing the warehouses) and set the state back to a copy
+	SimulationState snapshot() const;
+	void restore(const SimulationState& state);
+
+	// Functions to build the state of an episode: add an order that is in the system, or set the state of a courier or a warehouse
+	int addOrder(const StateOrder& order);
+	StateCourier& courier(int index) { return couriers[index]; }
+	WarehouseState& mutableWarehouse(int warehouse);
+	void setTime(int time) { currentTime = time; }
+
+	// Function that adds an order arriving now and assigns it to warehouse (-1 to reject it). Returns the index of the order
+	int addArrival(int client, int timeToComission, int serviceTimeAtClient, int warehouse);
+
+	// Function that processes all courier arrivals at clients up to time (inclusive) and moves the state to this time
+	void advanceTo(int time);
+	// Function that processes courier arrivals until all orders in the system are served
+	void drain();
+
+	// Function that returns the warehouse of the nearest warehouse policy for a client: the closest one (within the service zones, if any) with couriers and an available picker, -1 to reject
+	int nearestWarehouse(int client) const;
+
+	// Function that simulates horizon seconds (but not beyond timeLimit) of arrivals drawn with rng, assigns them with the nearest warehouse policy
+	// and serves all orders afterwards
+	void rollout(int horizon, int timeLimit, XorShift128& rng);
+
+	// Costs since the state was built: waiting times of served orders plus penalties of rejected orders
+	long long getCosts() const { return costs; }
+	int getTime() const { return currentTime; }
+	int getNbOrders() const { return (int)orders.size(); }
+
+private:
+	const Data* data;
+	int currentTime;
+	long long costs;
+	std::vector<StateOrder> orders;									// All orders of the state, served ones included
+	std::vector<StateCourier> couriers;								// All couriers
+	std::vector<std::shared_ptr<WarehouseState>> warehouses;		// Copy-on-write state of each warehouse
+	std::vector<int> ordersInDelivery;								// Orders with a courier on the way, by increasing arrival time
+
+	// Function that assigns the fastest courier of a warehouse to an order whose picker has been chosen
+	void assignCourier(int order);
+	// Function that inserts an order with a courier into ordersInDelivery
+	void insertInDelivery(int order);
+	// Function that processes the arrival of the courier at the client of the next order in delivery
+	void serveNextOrder();
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "Environment.h"
+#include "ReplicationRunner.h"
+#include "Simulator.h"
+
+
+Simulator::Simulator(const std::string& fileName, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options)
+{
+    std::ifstream inputFile(fileName, std::ios::binary);
+    if (!inputFile) throw std::runtime_error("Could not find file instance " + fileName);
+    data.reset(new Data(inputFile, penaltyForNotServing, interArrivalTime, options));
+    createEnvironment();
+}
+
+Simulator::Simulator(std::istream& instance, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options)
+{
+    data.reset(new Data(instance, penaltyForNotServing, interArrivalTime, options));
+    createEnvironment();
+}
+
+Simulator::~Simulator()
+{
+}
+
+void Simulator::createEnvironment()
+{
+    environment.reset(new Environment(data.get()));
+}
+
+ReplicationResults Simulator::run(const std::string& method, int hours, int nbReplications, int firstEpoch, int batchWindow)
+{
+    if (nbReplications < 0) throw std::invalid_argument("The number of replications must not be negative");
+    std::lock_guard<std::mutex> lock(runMutex);
+    ReplicationResults results;
+    results.costs.reserve(nbReplications);
+    results.rejectionRates.reserve(nbReplications);
+    results.meanWaitingTimes.reserve(nbReplications);
+    results.maxWaitingTimes.reserve(nbReplications);
+    results.waitingTimeQuantiles.reserve(4 * nbReplications);
+    for (int r = 0; r < nbReplications; r++)
+    {
+        ReplicationRecord record = environment->simulateReplication(method, hours * 3600, ReplicationRunner::seedOfEpoch(firstEpoch + r), batchWindow);
+        results.costs.push_back(record.objValue);
+        results.rejectionRates.push_back(record.rejectionRate);
+        results.meanWaitingTimes.push_back(record.meanWaitingTime);
+        results.maxWaitingTimes.push_back(record.maxWaitingTime);
+        results.waitingTimeQuantiles.insert(results.waitingTimeQuantiles.end(), record.waitingTimeQuantiles, record.waitingTimeQuantiles + 4);
+    }
+    return results;
+}
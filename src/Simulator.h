@@ -0,0 +1,51 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Data.h"
+
+class Environment;
+
+// Results of a series of replications, one entry per replication
+struct ReplicationResults
+{
+	std::vector<long long> costs;				// Objective value: waiting times of the served orders plus penalties of the rejected ones
+	std::vector<float> rejectionRates;			// Share of the orders that were rejected
+	std::vector<float> meanWaitingTimes;		// Mean waiting time of the served orders
+	std::vector<int> maxWaitingTimes;			// Maximum waiting time of the served orders
+	std::vector<int> waitingTimeQuantiles;		// 50/90/95/99 percent quantiles of the waiting times, four per replication
+};
+
+// Entry point of the simulation library: holds an instance and runs replications of an evaluating method in-process, without argv or result files.
+// Replication r uses the random numbers of epoch firstEpoch + r of the replication runner, so the results are the ones of the command line with --workers
+class Simulator
+{
+public:
+	// Constructors: read the instance (text or binary format) from a file or from a stream, e.g., from memory. Options are the --name=value parameters
+	Simulator(const std::string& fileName, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options = {});
+	Simulator(std::istream& instance, int penaltyForNotServing, double interArrivalTime, const std::map<std::string, std::string>& options = {});
+	~Simulator();
+
+	// Function that simulates nbReplications episodes of hours hours with method (nearestWarehouse, testREINFORCE, batchAssignment or rollout).
+	// All calls share the environment, so calls on the same simulator from several threads run one after the other; use one simulator per thread to run in parallel
+	ReplicationResults run(const std::string& method, int hours, int nbReplications, int firstEpoch = 0, int batchWindow = 30);
+
+	// Problem instance
+	const Data& getData() const { return *data; }
+
+private:
+	std::unique_ptr<Data> data;						// Problem instance
+	std::unique_ptr<Environment> environment;		// Environment of all replications (it keeps the policy net once loaded)
+	std::mutex runMutex;							// Held by run while it uses the environment
+
+	// Function that creates the environment after the instance has been read
+	void createEnvironment();
+};
+
+#endif
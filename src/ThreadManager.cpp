@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+
+#include <torch/torch.h>
+
+#include "ThreadManager.h"
+
+
+ThreadManager::ThreadManager() : nbCores(1), nbNodes(1), pinning("none"), nbSimulationCores(0), nbIntraOpThreads(0), nbWorkerCpus(0)
+{
+    detectTopology();
+    setLayout("none", 0);
+}
+
+ThreadManager& ThreadManager::global()
+{
+    static ThreadManager threadManager;
+    return threadManager;
+}
+
+void ThreadManager::detectTopology()
+{
+    cpus.clear();
+#ifdef __linux__
+    auto readNumber = [](const std::string& fileName, int defaultValue){
+        std::ifstream file(fileName);
+        int value;
+        return (file >> value) ? value : defaultValue;
+    };
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (!CPU_ISSET(cpu, &allowed)) continue;
+            std::string directory = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+            CpuInfo info = {cpu, readNumber(directory + "/topology/core_id", cpu), readNumber(directory + "/topology/physical_package_id", 0), 0, 0};
+            // The NUMA node of a CPU is the nodeX link in its directory
+            if (DIR* entries = opendir(directory.c_str()))
+            {
+                while (dirent* entry = readdir(entries))
+                {
+                    std::string name(entry->d_name);
+                    if (name.compare(0, 4, "node") == 0 && name.size() > 4 && std::isdigit((unsigned char)name[4])) info.node = std::atoi(name.c_str() + 4);
+                }
+                closedir(entries);
+            }
+            cpus.push_back(info);
+        }
+    }
+#endif
+    if (cpus.empty())
+    {
+        int nbCpus = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < nbCpus; cpu++)
+        {
+            cpus.push_back(CpuInfo{cpu, cpu, 0, 0, 0});
+        }
+    }
+    std::set<std::pair<int, int>> cores;
+    std::set<int> nodes;
+    for (size_t i = 0; i < cpus.size(); i++)
+    {
+        for (size_t j = 0; j < i; j++)
+        {
+            if (cpus[j].package == cpus[i].package && cpus[j].core == cpus[i].core) cpus[i].sibling++;
+        }
+        cores.insert(std::make_pair(cpus[i].package, cpus[i].core));
+        nodes.insert(cpus[i].node);
+    }
+    nbCores = cores.size();
+    nbNodes = nodes.size();
+}
+
+void ThreadManager::setLayout(const std::string& pinning, int nbSimulationCores)
+{
+    if (pinning != "none" && pinning != "core" && pinning != "numa") throw std::invalid_argument("Unknown thread pinning: " + pinning);
+    this->pinning = pinning;
+    this->nbSimulationCores = (nbSimulationCores > 0 && nbSimulationCores < nbCores) ? nbSimulationCores : 0;
+
+    // Physical cores are ordered by NUMA node, so the simulation cores of a split are on as few nodes as possible
+    std::vector<std::tuple<int, int, int>> cores;
+    for (const CpuInfo& info : cpus)
+    {
+        cores.push_back(std::make_tuple(info.node, info.package, info.core));
+    }
+    std::sort(cores.begin(), cores.end());
+    cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+    std::set<std::tuple<int, int, int>> simulationCores(cores.begin(), cores.begin() + (this->nbSimulationCores > 0 ? this->nbSimulationCores : cores.size()));
+
+    std::vector<CpuInfo> simulation;
+    inferenceCpus.clear();
+    for (const CpuInfo& info : cpus)
+    {
+        bool isSimulationCore = simulationCores.count(std::make_tuple(info.node, info.package, info.core)) > 0;
+        if (isSimulationCore) simulation.push_back(info);
+        if (!isSimulationCore || this->nbSimulationCores == 0) inferenceCpus.push_back(info.cpu);
+    }
+    // Hardware threads share the caches and units of their core, so each core gets one simulation thread before any core gets a second one
+    std::sort(simulation.begin(), simulation.end(), [](const CpuInfo& a, const CpuInfo& b){
+        return std::make_tuple(a.sibling, a.node, a.package, a.core) < std::make_tuple(b.sibling, b.node, b.package, b.core);
+    });
+    simulationCpus.clear();
+    simulationNodes.clear();
+    std::vector<int> nodeOrder;
+    for (const CpuInfo& info : simulation)
+    {
+        simulationCpus.push_back(info.cpu);
+        int n = std::find(nodeOrder.begin(), nodeOrder.end(), info.node) - nodeOrder.begin();
+        if (n == (int)nodeOrder.size())
+        {
+            nodeOrder.push_back(info.node);
+            simulationNodes.push_back(std::vector<int>());
+        }
+        simulationNodes[n].push_back(info.cpu);
+    }
+}
+
+void ThreadManager::configure(const Data& data)
+{
+    nbIntraOpThreads = std::max(0, (int)data.getOption("intraOpThreads", 0.0));
+    setLayout(data.getOption("pinThreads", "none"), (int)data.getOption("simulationCores", 0.0));
+    // The inter-op pool can only be sized before it is used for the first time
+    if (data.hasOption("interOpThreads"))
+    {
+        torch::set_num_interop_threads(std::max(1, (int)data.getOption("interOpThreads", 1.0)));
+    }
+    if (nbIntraOpThreads > 0 || nbSimulationCores > 0)
+    {
+        torch::set_num_threads(getNbInferenceThreads(1));
+    }
+    pinInferenceThread();
+    if (data.hasOption("pinThreads") || data.hasOption("simulationCores") || data.hasOption("intraOpThreads") || data.hasOption("interOpThreads"))
+    {
+        std::cout << "----- " << describe() << " -----" << std::endl;
+    }
+}
+
+void ThreadManager::pinSimulationThread(int index, int nbCpus) const
+{
+    // A thread starts on the CPUs of the thread that created it. If these are some of the simulation CPUs (e.g., the slice of a replication worker),
+    // the thread belongs to a nested pool (e.g., rollout threads) and index counts within the slice, so nested pools of different workers do not collide
+    std::vector<int> parentCpus = getCallingThreadCpus(simulationCpus);
+    if (pinning == "core")
+    {
+        std::vector<int> cpuSet;
+        for (int c = 0; c < std::max(1, nbCpus); c++)
+        {
+            cpuSet.push_back(parentCpus[(index * std::max(1, nbCpus) + c) % parentCpus.size()]);
+        }
+        setAffinity(cpuSet);
+    }
+    else if (pinning == "numa")
+    {
+        std::vector<std::vector<int>> parentNodes;
+        for (const std::vector<int>& node : simulationNodes)
+        {
+            std::vector<int> cpuSet;
+            for (int cpu : node)
+            {
+                if (std::find(parentCpus.begin(), parentCpus.end(), cpu) != parentCpus.end()) cpuSet.push_back(cpu);
+            }
+            if (!cpuSet.empty()) parentNodes.push_back(cpuSet);
+        }
+        setAffinity(parentNodes[index % parentNodes.size()]);
+    }
+    else if (nbSimulationCores > 0)
+    {
+        setAffinity(parentCpus);
+    }
+}
+
+void ThreadManager::pinReplicationWorker(int index, int nbCpus)
+{
+    pinSimulationThread(index, nbCpus);
+    nbWorkerCpus = std::max(1, nbCpus);
+}
+
+void ThreadManager::pinInferenceThread() const
+{
+    // Without any layout, the threads are left alone
+    if (pinning != "none" || nbSimulationCores > 0)
+    {
+        setAffinity(inferenceCpus);
+    }
+}
+
+int ThreadManager::getNbInferenceThreads(int defaultThreads) const
+{
+    if (nbIntraOpThreads > 0) return nbIntraOpThreads;
+    if (nbSimulationCores > 0) return inferenceCpus.size();
+    return defaultThreads;
+}
+
+int ThreadManager::getNbSimulationThreads() const
+{
+    int nbCpus = getCallingThreadCpus(simulationCpus).size();
+    if (nbWorkerCpus > 0) nbCpus = std::min(nbCpus, nbWorkerCpus);
+    return std::max(1, nbCpus);
+}
+
+std::string ThreadManager::describe() const
+{
+    std::ostringstream text;
+    text << cpus.size() << " CPUs on " << nbCores << " cores and " << nbNodes << " NUMA nodes, simulation threads pinned: " << pinning;
+    if (nbSimulationCores > 0)
+    {
+        text << ", " << nbSimulationCores << " cores (" << simulationCpus.size() << " CPUs) for simulation and " << inferenceCpus.size() << " CPUs for inference";
+    }
+    text << ", intra-op threads: " << torch::get_num_threads() << ", inter-op threads: " << torch::get_num_interop_threads();
+    return text.str();
+}
+
+std::vector<int> ThreadManager::getCallingThreadCpus(const std::vector<int>& cpuSet)
+{
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+    {
+        std::vector<int> allowed;
+        for (int cpu : cpuSet)
+        {
+            if (CPU_ISSET(cpu, &mask)) allowed.push_back(cpu);
+        }
+        if (!allowed.empty()) return allowed;
+    }
+#endif
+    return cpuSet;
+}
+
+void ThreadManager::setAffinity(const std::vector<int>& cpuSet)
+{
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpuSet)
+    {
+        CPU_SET(cpu, &mask);
+    }
+    // For pid 0 the mask applies to the calling thread only
+    sched_setaffinity(0, sizeof(mask), &mask);
+#else
+    (void)cpuSet;
+#endif
+}
@@ -0,0 +1,77 @@
+#ifndef THREADMANAGER_H
+#define THREADMANAGER_H
+
+#include <string>
+#include <vector>
+
+#include "Data.h"
+
+// Logical CPU (hardware thread) with its place in the topology of the machine
+struct CpuInfo
+{
+	int cpu;					// Index of the logical CPU
+	int core;					// Physical core within its package
+	int package;				// Socket
+	int node;					// NUMA node
+	int sibling;				// Index among the hardware threads of its core (0 for the first one)
+};
+
+// Class that lays out the threads of the process on the CPUs it may run on (Linux only, elsewhere the threads are left to the scheduler).
+// The physical cores can be split between simulation threads (actors, rollout threads, replication workers) and inference, i.e., the libtorch
+// pools: the main thread is restricted to the inference cores, so the pools it creates inherit them. Simulation threads are pinned
+// to one CPU each (first hardware threads of all cores before their siblings), to the simulation CPUs of one NUMA node each, or not at all
+class ThreadManager
+{
+public:
+	// Thread manager of the process
+	static ThreadManager& global();
+
+	// Function that reads the topology and the options --pinThreads=none|core|numa, --simulationCores=k (0: no split), --intraOpThreads=n and
+	// --interOpThreads=n, sizes the libtorch pools and restricts the calling (main) thread to the inference CPUs. Called once at startup
+	void configure(const Data& data);
+
+	// Function that sets the layout: pinning of simulation threads and number of physical cores reserved for them (0 to share all cores)
+	void setLayout(const std::string& pinning, int nbSimulationCores);
+
+	// Function that pins the calling thread as simulation thread index, which uses nbCpus CPUs (e.g., its own intra-op threads). Indices count
+	// within the simulation CPUs the thread inherited from its creator, so a pool started by a pinned thread stays on the CPUs of that thread
+	void pinSimulationThread(int index, int nbCpus = 1) const;
+	// Function that pins the calling process as replication worker index with nbCpus CPUs. The simulation threads the worker starts itself
+	// (e.g., rollout threads) are then limited to these CPUs
+	void pinReplicationWorker(int index, int nbCpus);
+	// Function that restricts the calling thread to the inference CPUs
+	void pinInferenceThread() const;
+
+	// Function that returns the number of intra-op threads for inference: --intraOpThreads if given, the inference CPUs if the cores are split,
+	// defaultThreads otherwise
+	int getNbInferenceThreads(int defaultThreads) const;
+
+	// Function that returns the number of simulation threads the process can run without oversubscribing the CPUs: the simulation CPUs,
+	// or the CPUs of a replication worker
+	int getNbSimulationThreads() const;
+
+	// Function that returns a one-line description of the topology and the layout
+	std::string describe() const;
+
+private:
+	std::vector<CpuInfo> cpus;							// CPUs the process may run on
+	int nbCores;										// Number of physical cores among them
+	int nbNodes;										// Number of NUMA nodes among them
+	std::string pinning;								// Pinning of simulation threads: "none", "core" or "numa"
+	int nbSimulationCores;								// Physical cores reserved for simulation threads (0 if not split)
+	int nbIntraOpThreads;								// Intra-op threads given with --intraOpThreads (0 if not given)
+	std::vector<int> simulationCpus;					// CPUs of simulation threads, first hardware threads of all cores before their siblings
+	std::vector<std::vector<int>> simulationNodes;		// Simulation CPUs of each NUMA node
+	std::vector<int> inferenceCpus;						// CPUs of inference
+	int nbWorkerCpus;									// CPUs of the process if it is a replication worker (0 otherwise)
+
+	ThreadManager();
+	// Function that reads the allowed CPUs and their cores, packages and NUMA nodes
+	void detectTopology();
+	// Function that returns the CPUs of a set that the calling thread may run on, or the whole set if it may run on none of them
+	static std::vector<int> getCallingThreadCpus(const std::vector<int>& cpuSet);
+	// Function that restricts the calling thread to a set of CPUs
+	static void setAffinity(const std::vector<int>& cpuSet);
+};
+
+#endif
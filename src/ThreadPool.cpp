@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(int nbThreads, const std::function<void(int)>& setUp) : job(nullptr), nbJobThreads(0), nbRunning(0), nbJobs(0), stopping(false)
+{
+    for (int t = 0; t < nbThreads; t++)
+    {
+        threads.emplace_back(&ThreadPool::runThread, this, t, setUp);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobStarted.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(const std::function<void(int)>& job, int nbThreads)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    this->job = &job;
+    nbJobThreads = std::max(0, std::min(nbThreads, (int)threads.size()));
+    nbRunning = nbJobThreads;
+    error = nullptr;
+    nbJobs++;
+    jobStarted.notify_all();
+    jobFinished.wait(lock, [this]{ return nbRunning == 0; });
+    this->job = nullptr;
+    if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::runThread(int index, std::function<void(int)> setUp)
+{
+    setUp(index);
+    long nbJobsSeen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        jobStarted.wait(lock, [&]{ return stopping || nbJobs != nbJobsSeen; });
+        if (stopping) return;
+        nbJobsSeen = nbJobs;
+        // Threads beyond the ones the job needs go back to sleep
+        if (index >= nbJobThreads) continue;
+        const std::function<void(int)>& currentJob = *job;
+        lock.unlock();
+        try
+        {
+            currentJob(index);
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+        if (--nbRunning == 0) jobFinished.notify_one();
+    }
+}
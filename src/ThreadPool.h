@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of threads that are started once and then run jobs together, e.g., the rollouts of the candidates of each decision of the rollout policy.
+// A job is a function of the index of a thread: run starts it on the first nbThreads threads of the pool and waits until all of them are done.
+// Between jobs the threads sleep on a condition variable, so a job only pays for waking them up, not for creating, pinning and joining them
+class ThreadPool
+{
+public:
+	// Constructor: starts nbThreads threads, each calls setUp with its index once before its first job (e.g., to pin itself)
+	ThreadPool(int nbThreads, const std::function<void(int)>& setUp);
+	// Destructor: stops and joins the threads
+	~ThreadPool();
+
+	// Function that runs job(t) on thread t of the pool for t = 0, ..., nbThreads - 1 (at most the size of the pool) and returns when all of them
+	// are done. The calling thread only waits. If a job throws, the first exception is rethrown here
+	void run(const std::function<void(int)>& job, int nbThreads);
+
+	int size() const { return threads.size(); }
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable jobStarted;			// Wakes the threads up for a new job or to stop
+	std::condition_variable jobFinished;		// Wakes run up when the last thread of the job is done
+	const std::function<void(int)>* job;		// Current job, the number of threads it runs on and the number of them that are not done yet
+	int nbJobThreads;
+	int nbRunning;
+	long nbJobs;								// Number of jobs started, so each thread takes part in each job once
+	std::exception_ptr error;					// First exception of the current job
+	bool stopping;
+
+	// Function of thread index of the pool
+	void runThread(int index, std::function<void(int)> setUp);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef TIMEDEPENDENTMATRIX_H
+#define TIMEDEPENDENTMATRIX_H
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Implementation of a matrix whose values change over the day in time slots of fixed length (e.g., travel times in 15-minute slots)
+// Each slice (the matrix of one slot) is stored as a flat row-major block, and slots with identical matrices share one block.
+// A small table maps each slot to the offset of its block, so a lookup at event time is one division, one modulo and two loads without branches.
+// Slots repeat cyclically, i.e., after the last slot of the day the first one is used again
+class TimeDependentMatrix
+{
+    int cols_;                          // The number of columns of each slice
+    int rows_;                          // The number of rows of each slice
+    int slotLength_;                    // The length of a time slot (in seconds)
+    std::vector<int> sliceOffsets_;     // For each slot, the offset of its slice in data_
+    std::vector<uint64_t> sliceHashes_; // Hash of each distinct slice, used to find duplicates
+    std::vector<int> data_;             // The distinct slices, one after another
+
+    // Function that returns the FNV-1a hash of a slice
+    static uint64_t hashSlice(const std::vector<int>& slice)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int value : slice)
+        {
+            hash ^= (uint32_t)value;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Function that returns the slot that contains time. The matrix needs at least one slot
+    int slotOf(const int time) const
+    {
+        assert(!sliceOffsets_.empty());
+        return (std::max(time, 0) / slotLength_) % (int)sliceOffsets_.size();
+    }
+
+public:
+    // Empty constructor: with zero columns, rows and slots
+    TimeDependentMatrix() : cols_(0), rows_(0), slotLength_(1)
+    {}
+
+    // Constructor: create a matrix of size dimensionX by dimensionY that does not change over time, i.e., one slot covering the whole day
+    TimeDependentMatrix(const int dimensionX, const int dimensionY) : cols_(dimensionY), rows_(dimensionX), slotLength_(24*3600)
+    {
+        data_ = std::vector<int>(dimensionX * dimensionY);
+        sliceOffsets_ = std::vector<int>(1, 0);
+        sliceHashes_ = std::vector<uint64_t>(1, 0);
+    }
+
+    // Constructor: create a matrix of size dimensionX by dimensionY without slots, the slots are added with addSlot
+    TimeDependentMatrix(const int dimensionX, const int dimensionY, const int slotLength) : cols_(dimensionY), rows_(dimensionX), slotLength_(slotLength)
+    {
+        if (slotLength <= 0) throw std::invalid_argument("Time slot length must be positive");
+    }
+
+    // Add the slice of the next time slot. If an identical slice has been added before, the slot points to that slice
+    void addSlot(const std::vector<int>& slice)
+    {
+        if ((int)slice.size() != rows_ * cols_) throw std::invalid_argument("Time slot has the wrong dimension");
+        uint64_t hash = hashSlice(slice);
+        for (size_t s = 0; s < sliceHashes_.size(); s++)
+        {
+            int offset = (int)s * rows_ * cols_;
+            if (sliceHashes_[s] == hash && std::equal(slice.begin(), slice.end(), data_.begin() + offset))
+            {
+                sliceOffsets_.push_back(offset);
+                return;
+            }
+        }
+        sliceOffsets_.push_back((int)data_.size());
+        sliceHashes_.push_back(hash);
+        data_.insert(data_.end(), slice.begin(), slice.end());
+    }
+
+    // Set a value val at position (row, col) in the first slice. Only meant for matrices that do not change over time
+    void set(const int row, const int col, const int val)
+    {
+        data_[cols_ * row + col] = val;
+    }
+
+    // Get the value at position (row, col) in the first slot
+    int get(const int row, const int col) const
+    {
+        assert(!sliceOffsets_.empty());
+        return data_[sliceOffsets_[0] + cols_ * row + col];
+    }
+
+    // Get the value at position (row, col) in the slot that contains time (in seconds since the start of the simulation)
+    int get(const int row, const int col, const int time) const
+    {
+        const int slot = slotOf(time);
+        return data_[sliceOffsets_[slot] + cols_ * row + col];
+    }
+
+    // Get row of the matrix in the first slot
+    std::vector<int> getRow(const int row) const
+    {
+        return getRow(row, 0);
+    }
+
+    // Get row of the matrix in the slot that contains time
+    std::vector<int> getRow(const int row, const int time) const
+    {
+        const int slot = slotOf(time);
+        const int* rowStart = &data_[sliceOffsets_[slot] + cols_ * row];
+        return std::vector<int>(rowStart, rowStart + cols_);
+    }
+
+    // Get a pointer to the row of the matrix in the slot that contains time, without copying it. Valid until a slot is added
+    const int* getRowData(const int row, const int time) const
+    {
+        const int slot = slotOf(time);
+        return &data_[sliceOffsets_[slot] + cols_ * row];
+    }
+
+    // Number of time slots
+    int nbSlots() const
+    {
+        return (int)sliceOffsets_.size();
+    }
+
+    // Number of distinct slices that are stored
+    int nbDistinctSlices() const
+    {
+        return rows_ * cols_ == 0 ? 0 : (int)data_.size() / (rows_ * cols_);
+    }
+
+    // Length of a time slot (in seconds)
+    int slotLength() const
+    {
+        return slotLength_;
+    }
+};
+
+#endif
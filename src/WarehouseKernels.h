@@ -0,0 +1,46 @@
+#ifndef WAREHOUSEKERNELS_H
+#define WAREHOUSEKERNELS_H
+
+#include <array>
+#include <vector>
+
+// State of an assignment decision for a number of warehouses N that is known at compile time: a std::array on the stack instead of a
+// vector on the heap, filled by loops with constant trip counts. WarehouseKernels<0> is the fallback for any other number of warehouses,
+// which is then given at runtime. The state builder is chosen once per instance and called through a pointer, so the specialization stays
+// inside it. The scalar loops of a decision (nearest warehouse, argmax and sampling of the policy output) use the runtime size: with 10
+// warehouses, fixed-size versions took the same time per call whether inlined or called through a pointer
+template <int N>
+struct WarehouseKernels
+{
+    // State of a decision: travel times to the N warehouses, then four load values per warehouse
+    typedef std::array<float, 5 * N> State;
+
+    static State makeState(int)
+    {
+        return State();
+    }
+
+    // Number of warehouses (a compile-time constant after inlining)
+    static int count(int)
+    {
+        return N;
+    }
+};
+
+template <>
+struct WarehouseKernels<0>
+{
+    typedef std::vector<float> State;
+
+    static State makeState(int nbWarehouses)
+    {
+        return State(5 * nbWarehouses);
+    }
+
+    static int count(int nbWarehouses)
+    {
+        return nbWarehouses;
+    }
+};
+
+#endif
@@ -1,18 +1,76 @@
 #include <time.h>
 #include <iostream>
 #include <typeinfo>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 
 #include "Data.h"
 #include "Environment.h"
+#include "Metrics.h"
+#include "ThreadManager.h"
+#include "ParameterSweep.h"
+#include "ReplicationRunner.h"
 
 int main(int argc, char * argv[])
 {
+  // Optional parameters of the form --name=value may be given anywhere, the remaining arguments are positional
+  std::vector<char*> positionalArguments;
+  std::map<std::string, std::string> options;
+  for (int i = 0; i < argc; i++){
+    std::string argument(argv[i]);
+    if (i > 0 && argument.compare(0, 2, "--") == 0){
+      size_t separator = argument.find('=');
+      options[argument.substr(2, separator == std::string::npos ? std::string::npos : separator - 2)] = separator == std::string::npos ? "1" : argument.substr(separator + 1);
+    }else{
+      positionalArguments.push_back(argv[i]);
+    }
+  }
+  if (positionalArguments.size() < 6){
+    std::cerr << "Usage: " << argv[0] << " instance hours penalty interArrivalTime method [arguments of the method] [--name=value ...]" << std::endl;
+    return 1;
+  }
+  positionalArguments.push_back(nullptr);
+  argv = positionalArguments.data();
+
   // Reading the data file and initializing some data structures
   std::cout << "----- READING DATA SET " << argv[1] << " -----" << std::endl;
-  Data data(argv);
+  Data data(argv, options);
   std::cout << "----- Instance with " << data.nbClients << " Clients, " << data.nbWarehouses << " Warehouses -----"<< std::endl;
 
+  // Size the libtorch pools and lay out the threads on the cores before any of them is started
+  ThreadManager::global().configure(data);
+
+  // With --metricsFile or --metricsPort, the metrics of the method are published every --metricsInterval seconds while it runs.
+  // Not with --workers, whose simulations run in separate processes
+  std::unique_ptr<MetricsPublisher> metricsPublisher;
+  if ((data.hasOption("metricsFile") || data.hasOption("metricsPort")) && !data.hasOption("workers")){
+    metricsPublisher.reset(new MetricsPublisher(MetricsRegistry::global(), data.getOption("metricsFile", ""), (int)data.getOption("metricsPort", 0.0), data.getOption("metricsInterval", 5.0)));
+  }
+
+  // A sweep trains several configurations on the same data, each in its own environment
+  if (std::string(argv[5]) == "sweepREINFORCE"){
+    ParameterSweep sweep(&data);
+    sweep.simulate(argv);
+    return 0;
+  }
+
+  // With --workers, the replications of an evaluating method are sharded over worker processes
+  if (data.hasOption("workers")){
+    ReplicationRunner runner(&data);
+    try{
+      runner.simulate(argv);
+    }catch (const std::invalid_argument& error){
+      // Arguments the replications cannot run with are refused before any worker is started
+      std::cerr << error.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   // Creating the Environment
   Environment environment(&data);
   environment.simulate(argv);
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "AuctionSolver.h"
+#include "Check.h"
+#include "xorshift128.h"
+
+
+// Sparse assignment problem: hasEdge[row][column] tells whether the row may take the column
+struct Problem
+{
+    std::vector<std::vector<bool>> hasEdge;
+    std::vector<std::vector<double>> benefits;
+};
+
+// Sum of the benefits of an assignment, checking that each row with edges has one of them and that no column is taken twice
+static double assignmentBenefit(const Problem& problem, const std::vector<int>& assignment)
+{
+    std::vector<bool> taken(problem.benefits[0].size(), false);
+    double total = 0.0;
+    for (size_t row = 0; row < problem.benefits.size(); row++)
+    {
+        int column = assignment[row];
+        bool hasEdges = std::find(problem.hasEdge[row].begin(), problem.hasEdge[row].end(), true) != problem.hasEdge[row].end();
+        CHECK((column >= 0) == hasEdges);
+        if (column < 0) continue;
+        CHECK(problem.hasEdge[row][column]);
+        CHECK(!taken[column]);
+        taken[column] = true;
+        total += problem.benefits[row][column];
+    }
+    return total;
+}
+
+// Highest benefit over all assignments of the rows from row on, by enumerating them (rows without edges stay unassigned)
+static double bruteForceBenefit(const Problem& problem, size_t row, std::vector<bool>& taken)
+{
+    if (row == problem.benefits.size()) return 0.0;
+    double best = -std::numeric_limits<double>::infinity();
+    bool hasEdges = false;
+    for (size_t column = 0; column < taken.size(); column++)
+    {
+        if (!problem.hasEdge[row][column]) continue;
+        hasEdges = true;
+        if (taken[column]) continue;
+        taken[column] = true;
+        best = std::max(best, problem.benefits[row][column] + bruteForceBenefit(problem, row + 1, taken));
+        taken[column] = false;
+    }
+    return hasEdges ? best : bruteForceBenefit(problem, row + 1, taken);
+}
+
+// Random instances shaped like a batch of the batch assignment: 4 orders, 4 courier slots that some of them may take (benefit: minus the
+// waiting time), and a private reject column per order, so every row can be assigned. With epsilon < 1/nbRows the auction is optimal
+static void testOptimalOnTinyInstances()
+{
+    XorShift128 rng(7);
+    AuctionSolver solver;
+    for (int instance = 0; instance < 500; instance++)
+    {
+        const int nbRows = 4, nbSlots = 4, nbColumns = nbSlots + nbRows;
+        Problem problem;
+        problem.hasEdge.assign(nbRows, std::vector<bool>(nbColumns, false));
+        problem.benefits.assign(nbRows, std::vector<double>(nbColumns, 0.0));
+        solver.reset(nbRows, nbColumns);
+        for (int row = 0; row < nbRows; row++)
+        {
+            for (int column = 0; column < nbSlots; column++)
+            {
+                if (rng() % 3 == 0) continue;
+                problem.hasEdge[row][column] = true;
+                problem.benefits[row][column] = -(double)(rng() % 30);
+                solver.addEdge(row, column, problem.benefits[row][column]);
+            }
+            problem.hasEdge[row][nbSlots + row] = true;
+            problem.benefits[row][nbSlots + row] = -25.0;
+            solver.addEdge(row, nbSlots + row, -25.0);
+        }
+        std::vector<int> assignment;
+        CHECK(solver.solve(assignment, 1.0 / (nbRows + 1), 1000000, 10.0));
+        CHECK((int)assignment.size() == nbRows);
+        std::vector<bool> taken(nbColumns, false);
+        CHECK(assignmentBenefit(problem, assignment) == bruteForceBenefit(problem, 0, taken));
+    }
+}
+
+// A row without edges stays unassigned. Two rows compete for column 0: the row with the higher benefit would take it, but then the other
+// row has no column left, so the optimum gives it to the other row
+static void testCompetingRows()
+{
+    AuctionSolver solver;
+    solver.reset(3, 2);
+    solver.addEdge(0, 0, 5.0);
+    solver.addEdge(2, 0, 8.0);
+    solver.addEdge(2, 1, 1.0);
+    std::vector<int> assignment;
+    CHECK(solver.solve(assignment, 0.25, 1000000, 10.0));
+    CHECK(assignment == std::vector<int>({0, -1, 1}));
+}
+
+int main()
+{
+    testOptimalOnTinyInstances();
+    testCompetingRows();
+    return 0;
+}
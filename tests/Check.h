@@ -0,0 +1,18 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdlib>
+#include <iostream>
+
+// Check of a unit test. Unlike assert, it is also evaluated in release builds, and a failure ends the test with the expression and its line
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+            std::exit(1); \
+        } \
+    } while (0)
+
+#endif
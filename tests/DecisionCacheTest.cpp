@@ -0,0 +1,73 @@
+#include <vector>
+
+#include "Check.h"
+#include "DecisionCache.h"
+
+
+// Function that returns the cached action of key, or -1 if it is not in the cache
+static int cachedAction(DecisionCache& cache, const std::vector<int>& key)
+{
+    int action = -1;
+    return cache.find(key, action) ? action : -1;
+}
+
+// With one shard of three entries, the least recently used entry is evicted, and both a hit and a replacement count as a use
+static void testLeastRecentlyUsedEviction()
+{
+    DecisionCache cache(3, 1);
+    CHECK(cache.getCapacity() == 3);
+    std::vector<int> a = {1, 0, 0}, b = {2, 0, 0}, c = {3, 0, 0}, d = {4, 0, 0}, e = {5, 0, 0};
+    cache.insert(a, 10);
+    cache.insert(b, 20);
+    cache.insert(c, 30);
+    CHECK(cache.size() == 3);
+    CHECK(cache.getNbEvictions() == 0);
+
+    // a is used again, so b is the least recently used entry when d is added
+    CHECK(cachedAction(cache, a) == 10);
+    cache.insert(d, 40);
+    CHECK(cache.size() == 3);
+    CHECK(cache.getNbEvictions() == 1);
+    CHECK(cachedAction(cache, b) == -1);
+    CHECK(cachedAction(cache, c) == 30);
+    CHECK(cachedAction(cache, a) == 10);
+    CHECK(cachedAction(cache, d) == 40);
+
+    // Replacing an action does not evict anything and counts as a use: after c, a and d, c is the least recently used entry
+    cache.insert(c, 31);
+    cache.insert(a, 11);
+    cache.insert(d, 41);
+    CHECK(cache.getNbEvictions() == 1);
+    cache.insert(e, 50);
+    CHECK(cache.getNbEvictions() == 2);
+    CHECK(cachedAction(cache, c) == -1);
+    CHECK(cachedAction(cache, a) == 11);
+    CHECK(cachedAction(cache, d) == 41);
+    CHECK(cachedAction(cache, e) == 50);
+
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(cachedAction(cache, a) == -1);
+}
+
+// With several shards, the cache never holds more entries than its capacity and keeps the most recent key of each shard
+static void testShardedCapacity()
+{
+    DecisionCache cache(64, 5);
+    CHECK(cache.getCapacity() == 64);
+    for (int k = 0; k < 1000; k++)
+    {
+        std::vector<int> key = {k, k % 7, -k};
+        cache.insert(key, k);
+        CHECK(cachedAction(cache, key) == k);
+        CHECK(cache.size() <= 64);
+    }
+    CHECK(cache.getNbEvictions() == 1000 - (long long)cache.size());
+}
+
+int main()
+{
+    testLeastRecentlyUsedEviction();
+    testShardedCapacity();
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "IsochroneIndex.h"
+#include "xorshift128.h"
+
+typedef std::vector<std::pair<double, double>> Ring;
+
+
+// Ring of a regular polygon with nbVertices vertices around (lon, lat), with a radius that alternates between radius and innerRadius (a star)
+static Ring star(double lon, double lat, double radius, double innerRadius, int nbVertices)
+{
+    Ring ring;
+    for (int v = 0; v < nbVertices; v++)
+    {
+        double angle = 2.0 * std::acos(-1.0) * v / nbVertices;
+        double r = v % 2 == 0 ? radius : innerRadius;
+        ring.push_back(std::make_pair(lon + r * std::cos(angle), lat + r * std::sin(angle)));
+    }
+    return ring;
+}
+
+// Zones that overlap, one of them with a hole and one made of two polygons, around Munich
+static IsochroneIndex buildIndex(int gridSize)
+{
+    IsochroneIndex index;
+    index.addZone(0, {star(11.55, 48.13, 0.10, 0.10, 64)});
+    index.addZone(1, {star(11.60, 48.15, 0.12, 0.05, 18), star(11.60, 48.15, 0.02, 0.02, 8)});
+    index.addZone(2, {star(11.45, 48.10, 0.03, 0.03, 4), star(11.70, 48.20, 0.04, 0.02, 10)});
+    index.addZone(3, {{{11.50, 48.05}, {11.65, 48.05}, {11.65, 48.06}, {11.51, 48.06}, {11.51, 48.20}, {11.50, 48.20}}});
+    index.build(gridSize);
+    return index;
+}
+
+// The grid must answer like the exact test against all edges, on random points of the bounding box and a margin around it
+static void testAgreesWithZoneContains(int gridSize)
+{
+    IsochroneIndex index = buildIndex(gridSize);
+    CHECK(index.getNbZones() == 4);
+    XorShift128 rng(gridSize);
+    int nbInside = 0;
+    for (int p = 0; p < 200000; p++)
+    {
+        double lon = 11.30 + 0.55 * (rng() * (1.0 / 4294967296.0));
+        double lat = 47.95 + 0.35 * (rng() * (1.0 / 4294967296.0));
+        uint64_t zones = index.zonesContaining(lon, lat);
+        for (int w = 0; w < index.getNbZones(); w++)
+        {
+            CHECK(((zones >> w & 1) != 0) == index.zoneContains(w, lon, lat));
+        }
+        CHECK(zones >> index.getNbZones() == 0);
+        if (zones != 0) nbInside++;
+    }
+    // The points are spread over both sides of the boundaries
+    CHECK(nbInside > 20000 && nbInside < 180000);
+}
+
+// Points whose answer is known from the shape of the zones
+static void testKnownPoints()
+{
+    IsochroneIndex index = buildIndex(32);
+    // Only in the disk of zone 0
+    CHECK(index.zonesContaining(11.47, 48.13) == 1);
+    // In the hole of zone 1
+    CHECK(index.zonesContaining(11.60, 48.15) == 1);
+    // Between the hole and the inner vertices of zone 1
+    CHECK(index.zonesContaining(11.64, 48.15) == 3);
+    // In each polygon of zone 2
+    CHECK(index.zonesContaining(11.45, 48.10) == 4);
+    CHECK(index.zonesContaining(11.70, 48.20) == 4);
+    // In the foot of the L of zone 3
+    CHECK(index.zonesContaining(11.58, 48.055) == 9);
+    // Outside of the grid
+    CHECK(index.zonesContaining(11.30, 47.90) == 0);
+}
+
+int main()
+{
+    testAgreesWithZoneContains(1);
+    testAgreesWithZoneContains(8);
+    testAgreesWithZoneContains(128);
+    testKnownPoints();
+    return 0;
+}
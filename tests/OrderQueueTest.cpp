@@ -0,0 +1,105 @@
+#include <vector>
+
+#include "Check.h"
+#include "OrderQueue.h"
+
+
+// Elements of the queue in FIFO order
+static std::vector<int*> contents(const OrderQueue<int>& queue)
+{
+    std::vector<int*> elements;
+    for (int* element : queue)
+    {
+        elements.push_back(element);
+    }
+    return elements;
+}
+
+static void testRemoveByHandle()
+{
+    int values[5] = {0, 1, 2, 3, 4};
+    OrderQueue<int> queue(8);
+    std::vector<long long> handles;
+    for (int& value : values)
+    {
+        handles.push_back(queue.push(&value));
+    }
+    // A removed element in the middle is skipped by the iterator and by pop, the front is removed in place
+    CHECK(queue.remove(handles[2]));
+    CHECK(queue.size() == 4);
+    CHECK(contents(queue) == std::vector<int*>({&values[0], &values[1], &values[3], &values[4]}));
+    CHECK(queue.remove(handles[0]));
+    CHECK(queue.front() == &values[1]);
+    queue.pop();
+    CHECK(queue.front() == &values[3]);
+    // Handles of removed or popped elements, and negative ones, are not in the queue anymore
+    CHECK(!queue.remove(handles[2]));
+    CHECK(!queue.remove(handles[1]));
+    CHECK(!queue.remove(-1));
+    CHECK(queue.size() == 2);
+    // Removing the last elements empties the queue
+    CHECK(queue.remove(handles[4]));
+    CHECK(queue.remove(handles[3]));
+    CHECK(queue.empty());
+    CHECK(queue.begin() == queue.end());
+    CHECK(queue.highWaterMark() == 5);
+}
+
+static void testWraparound()
+{
+    std::vector<int> values(64);
+    OrderQueue<int> queue(4);
+    // Positions run far past the capacity, the buffer wraps around and keeps its size as long as at most 4 elements wait
+    int next = 0;
+    for (int round = 0; round < 10; round++)
+    {
+        long long firstHandle = queue.push(&values[next++]);
+        long long secondHandle = queue.push(&values[next++]);
+        queue.push(&values[next++]);
+        CHECK(queue.remove(secondHandle));
+        CHECK(queue.front() == &values[next - 3]);
+        queue.pop();
+        CHECK(!queue.remove(firstHandle));
+        CHECK(queue.front() == &values[next - 1]);
+        queue.pop();
+        CHECK(queue.empty());
+    }
+    CHECK(queue.capacity() == 4);
+
+    // Growing while the elements wrap around keeps their order and their handles
+    queue.push(&values[next++]);
+    queue.push(&values[next++]);
+    queue.pop();
+    std::vector<long long> handles;
+    for (int i = 0; i < 6; i++)
+    {
+        handles.push_back(queue.push(&values[next + i]));
+    }
+    CHECK(queue.capacity() == 8);
+    CHECK(queue.size() == 7);
+    CHECK(queue.remove(handles[3]));
+    std::vector<int*> expected = {&values[next - 1]};
+    for (int i = 0; i < 6; i++)
+    {
+        if (i != 3) expected.push_back(&values[next + i]);
+    }
+    CHECK(contents(queue) == expected);
+    for (int* element : expected)
+    {
+        CHECK(queue.front() == element);
+        queue.pop();
+    }
+    CHECK(queue.empty());
+
+    // clear keeps the capacity and resets the high-water mark
+    queue.clear();
+    CHECK(queue.capacity() == 8);
+    CHECK(queue.highWaterMark() == 0);
+}
+
+int main()
+{
+    testRemoveByHandle();
+    testWraparound();
+    return 0;
+}